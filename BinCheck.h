@@ -0,0 +1,124 @@
+#ifndef AQC_BINCHECK_H_
+#define AQC_BINCHECK_H_
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Kernel for the bin-by-bin compatibility check of the ratio between two histograms.
+//
+// A bin is considered bad if its ratio deviates from unity by more than
+//   threshold + nSigma * error
+// The bins to be checked are given as a range of bin indexes, computed once from the axis,
+// and the values and errors of the ratio are read from flat arrays (see HistogramBuffers.h).
+
+struct BinCheckParameters
+{
+  double threshold{ 0.1 };
+  double nSigma{ 2.0 };
+};
+
+// inclusive range of bin indexes, with the ROOT numbering convention (1 to nBins)
+struct BinRange
+{
+  int first{ 1 };
+  int last{ 0 };
+};
+
+struct BinCheckResult
+{
+  int nBinsChecked{ 0 };
+  int nBinsBad{ 0 };
+  double score{ 0 }; // sum of the deviations of all the bad bins
+
+  double getFracBad() const { return (nBinsChecked > 0) ? (double(nBinsBad) / nBinsChecked) : 0; }
+};
+
+// Storage of values and errors computed outside of a histogram
+struct ValueErrorStorage
+{
+  const double* value{ nullptr };
+  const double* error{ nullptr };
+
+  double getValue(int bin) const { return value[bin]; }
+  double getError(int bin) const { return error[bin]; }
+};
+
+// count the bins whose ratio deviates from unity by more than the allowed threshold
+template <class Storage>
+BinCheckResult checkRatioBins(const Storage& storage, BinRange range, const BinCheckParameters& parameters)
+{
+  BinCheckResult result;
+  for (int bin = range.first; bin <= range.last; bin++) {
+    double deviation = std::fabs(storage.getValue(bin) - 1.0);
+    double threshold = parameters.threshold + storage.getError(bin) * parameters.nSigma;
+    result.nBinsChecked += 1;
+    if (deviation > threshold) {
+      result.nBinsBad += 1;
+      result.score += deviation;
+    }
+  }
+  return result;
+}
+
+// Same check for an arbitrary list of cells, given by their global indexes, as used for the 2-D histograms.
+// If badCells is not null, its elements corresponding to the bad cells are incremented by one
+template <class Storage>
+BinCheckResult checkRatioCells(const Storage& storage, const std::vector<int>& cells, const BinCheckParameters& parameters,
+                               double* badCells = nullptr)
+{
+  BinCheckResult result;
+  for (int cell : cells) {
+    double deviation = std::fabs(storage.getValue(cell) - 1.0);
+    double threshold = parameters.threshold + storage.getError(cell) * parameters.nSigma;
+    result.nBinsChecked += 1;
+    if (deviation > threshold) {
+      result.nBinsBad += 1;
+      result.score += deviation;
+      if (badCells) {
+        badCells[cell] += 1;
+      }
+    }
+  }
+  return result;
+}
+
+// range of the bins whose center is within [xmin, xmax], or all the bins if xmin == xmax.
+// The axis can be any type providing the GetNbins() and GetBinCenter() methods of TAxis
+template <class Axis>
+BinRange getCheckBinRange(const Axis* axis, double xmin, double xmax)
+{
+  BinRange range{ 1, axis->GetNbins() };
+  if (xmin == xmax) {
+    return range;
+  }
+
+  // bin centers are monotonically increasing, the limits are found with a binary search
+  int low = 1;
+  int high = axis->GetNbins() + 1;
+  while (low < high) {
+    int middle = (low + high) / 2;
+    if (axis->GetBinCenter(middle) < xmin) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  range.first = low;
+
+  low = 1;
+  high = axis->GetNbins() + 1;
+  while (low < high) {
+    int middle = (low + high) / 2;
+    if (axis->GetBinCenter(middle) <= xmax) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  range.last = low - 1;
+
+  return range;
+}
+
+#endif // AQC_BINCHECK_H_
@@ -0,0 +1,186 @@
+#ifndef AQC_COMPATIBILITYTESTS_H_
+#define AQC_COMPATIBILITYTESTS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "./BinCheck.h"
+#include "./HistogramBuffers.h"
+
+// Statistical compatibility tests between the distribution of a time window and the reference one.
+//
+// The tests complement the bin-by-bin check of the ratio, and are computed on the same rebinned and
+// normalized bin buffers. All the tests are evaluated together: the totals of the two distributions
+// are accumulated first, and the statistics of the four tests are then computed in a single sweep over
+// the checked bins, such that enabling several tests for a plot costs about the same as enabling one.
+//
+// The distributions are compared after normalizing them to unit integral in the checked bins. The number
+// of counts entering the Anderson-Darling and Poisson tests is the effective number of entries
+// sum(content)^2 / sum(error^2), which does not depend on the normalization of the buffers.
+
+enum class CompatibilityTestType {
+  Chi2,              // chi2 per degree of freedom
+  KolmogorovSmirnov, // maximum distance between the cumulative distributions
+  AndersonDarling,   // two-sample Anderson-Darling statistic for binned data
+  PoissonLikelihood  // Baker-Cousins likelihood ratio per degree of freedom
+};
+
+struct CompatibilityTest
+{
+  CompatibilityTestType type;
+  std::string name;
+  double maxBad;    // the time window is bad if the statistic is above this value
+  double maxMedium; // the time window is medium if the statistic is above this value
+
+  // 0 = good, 1 = medium, 2 = bad
+  int getQuality(double value) const { return (value > maxBad) ? 2 : ((value > maxMedium) ? 1 : 0); }
+};
+
+// names of the tests, as used in the configuration keys <name>MaxBad and <name>MaxMedium
+const std::vector<std::pair<std::string, CompatibilityTestType>> kCompatibilityTestNames{
+  { "chi2", CompatibilityTestType::Chi2 },
+  { "ks", CompatibilityTestType::KolmogorovSmirnov },
+  { "ad", CompatibilityTestType::AndersonDarling },
+  { "poisson", CompatibilityTestType::PoissonLikelihood }
+};
+
+// the Kolmogorov-Smirnov and Anderson-Darling tests use the cumulative distributions, and are not
+// defined for the cells of a 2-D comparison, which have no natural ordering
+inline bool requiresOrderedBins(CompatibilityTestType type)
+{
+  return (type == CompatibilityTestType::KolmogorovSmirnov || type == CompatibilityTestType::AndersonDarling);
+}
+
+struct CompatibilityTestValues
+{
+  double chi2{ 0 };
+  double ksDistance{ 0 };
+  double andersonDarling{ 0 };
+  double poissonLikelihood{ 0 };
+
+  double get(CompatibilityTestType type) const
+  {
+    switch (type) {
+      case CompatibilityTestType::Chi2:
+        return chi2;
+      case CompatibilityTestType::KolmogorovSmirnov:
+        return ksDistance;
+      case CompatibilityTestType::AndersonDarling:
+        return andersonDarling;
+      case CompatibilityTestType::PoissonLikelihood:
+        return poissonLikelihood;
+    }
+    return 0;
+  }
+};
+
+// Compute the statistics of all the tests over nCells cells, whose global indexes are given by cellIndex(i).
+// The cumulative distributions used by the Kolmogorov-Smirnov and Anderson-Darling tests follow the order
+// of the cells, and are therefore only computed if the cells are ordered along an axis
+template <class CellIndex>
+CompatibilityTestValues computeCompatibilityTests(const BinnedValues& numerator, const BinnedValues& denominator,
+                                                  int nCells, CellIndex cellIndex, bool ordered)
+{
+  CompatibilityTestValues result;
+  const double* n = numerator.content.data();
+  const double* en = numerator.error.data();
+  const double* d = denominator.content.data();
+  const double* ed = denominator.error.data();
+
+  // totals of the two distributions
+  double sumN = 0;
+  double sumD = 0;
+  double sumErrorsN2 = 0;
+  double sumErrorsD2 = 0;
+  for (int i = 0; i < nCells; i++) {
+    int cell = cellIndex(i);
+    sumN += n[cell];
+    sumD += d[cell];
+    sumErrorsN2 += en[cell] * en[cell];
+    sumErrorsD2 += ed[cell] * ed[cell];
+  }
+  if (sumN <= 0 || sumD <= 0) {
+    return result;
+  }
+  double scaleN = 1.0 / sumN;
+  double scaleD = 1.0 / sumD;
+  double entriesN = (sumErrorsN2 > 0) ? (sumN * sumN / sumErrorsN2) : 0;
+  double entriesD = (sumErrorsD2 > 0) ? (sumD * sumD / sumErrorsD2) : 0;
+  double weightN = (entriesN + entriesD > 0) ? (entriesN / (entriesN + entriesD)) : 0.5;
+  double weightD = 1.0 - weightN;
+
+  // single sweep over the cells
+  double chi2 = 0;
+  int chi2Ndf = 0;
+  double likelihood = 0;
+  int likelihoodNdf = 0;
+  double cumulativeN = 0;
+  double cumulativeD = 0;
+  double ksDistance = 0;
+  double andersonDarling = 0;
+  for (int i = 0; i < nCells; i++) {
+    int cell = cellIndex(i);
+    double p = n[cell] * scaleN;
+    double q = d[cell] * scaleD;
+    double ep = en[cell] * scaleN;
+    double eq = ed[cell] * scaleD;
+
+    double variance = ep * ep + eq * eq;
+    if (variance > 0) {
+      chi2 += (p - q) * (p - q) / variance;
+      chi2Ndf += 1;
+    }
+
+    // observed and expected counts of the time window
+    double observed = p * entriesN;
+    double expected = q * entriesN;
+    if (expected > 0) {
+      likelihood += 2 * (expected - observed + ((observed > 0) ? observed * std::log(observed / expected) : 0));
+      likelihoodNdf += 1;
+    }
+
+    cumulativeN += p;
+    cumulativeD += q;
+    double distance = cumulativeN - cumulativeD;
+    ksDistance = std::max(ksDistance, std::fabs(distance));
+
+    // pooled distribution and its cumulative
+    double pooled = weightN * p + weightD * q;
+    double pooledCumulative = weightN * cumulativeN + weightD * cumulativeD;
+    double pooledVariance = pooledCumulative * (1.0 - pooledCumulative);
+    if (pooledVariance > 0) {
+      andersonDarling += pooled * distance * distance / pooledVariance;
+    }
+  }
+
+  // one degree of freedom is removed by the normalization
+  result.chi2 = (chi2Ndf > 1) ? (chi2 / (chi2Ndf - 1)) : 0;
+  result.poissonLikelihood = (likelihoodNdf > 1) ? (likelihood / (likelihoodNdf - 1)) : 0;
+  if (ordered) {
+    result.ksDistance = ksDistance;
+    result.andersonDarling = (entriesN + entriesD > 0) ? (andersonDarling * entriesN * entriesD / (entriesN + entriesD)) : 0;
+  }
+  return result;
+}
+
+// compute the statistics of the checked bins or cells of a plot, in 1-D or 2-D.
+// In 2-D the cells have no natural ordering, and only the chi2 and Poisson tests are computed
+inline CompatibilityTestValues computeCompatibilityTests(const BinnedValues& numerator, const BinnedValues& denominator,
+                                                         const WindowBinning& binning)
+{
+  if (binning.is2D) {
+    auto& cells = binning.checkCells;
+    return computeCompatibilityTests(numerator, denominator, static_cast<int>(cells.size()),
+                                     [&cells](int i) { return cells[i]; }, false);
+  }
+  BinRange range = binning.checkRange;
+  range.last = std::min(range.last, numerator.getNbins());
+  int first = range.first;
+  return computeCompatibilityTests(numerator, denominator, std::max(range.last - range.first + 1, 0),
+                                   [first](int i) { return first + i; }, true);
+}
+
+#endif // AQC_COMPATIBILITYTESTS_H_
@@ -0,0 +1,189 @@
+#ifndef AQC_FILEPOOL_H_
+#define AQC_FILEPOOL_H_
+
+#include <cstddef>
+#include <future>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <TFile.h>
+
+#include "./InputMirror.h"
+#include "./Pipeline.h"
+
+// Bounded pool of open input files.
+//
+// The files are registered by name, and are only opened when they are accessed. At most maxOpenFiles
+// files are kept open, the least recently used one being closed when a new file needs to be opened.
+// A closed file is re-opened on the next access. The files are returned as shared pointers, such that
+// a file that is closed by the pool while it is still being read is only deleted once released.
+//
+// Remote files, given by URL, are read through local mirrors containing only the required objects
+// (see InputMirror.h) if a cache directory is set. The mirrors of the readAhead files registered after
+// the accessed one are updated in the background, such that the remote reads overlap with the
+// processing of the current file. The background updates hold the gate in shared mode, if one is set,
+// such that they are paused while the holder of the exclusive lock forks processes.
+class FilePool
+{
+ public:
+  explicit FilePool(size_t maxOpenFiles = 64) : mMaxOpenFiles(maxOpenFiles > 0 ? maxOpenFiles : 1) {}
+
+  FilePool(const FilePool&) = delete;
+  FilePool& operator=(const FilePool&) = delete;
+
+  void setMaxOpenFiles(size_t maxOpenFiles)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mMaxOpenFiles = (maxOpenFiles > 0) ? maxOpenFiles : 1;
+    evict();
+  }
+
+  // paths copied from the remote files into their mirrors (see InputMirror.h), an empty cache directory
+  // disabling the mirrors such that the remote files are read directly
+  void setMirror(const std::string& cacheDirectory, const std::vector<std::string>& paths, size_t readAhead)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mCacheDirectory = cacheDirectory;
+    mMirrorPaths = paths;
+    mReadAhead = readAhead;
+  }
+
+  // gate held in shared mode by the background updates of the mirrors
+  void setGate(PipelineGate* gate)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mGate = gate;
+  }
+
+  void add(const std::string& fileName)
+  {
+    mFileIndexes[fileName] = mFileNames.size();
+    mFileNames.push_back(fileName);
+  }
+
+  const std::vector<std::string>& getFileNames() const { return mFileNames; }
+  size_t size() const { return mFileNames.size(); }
+  bool empty() const { return mFileNames.empty(); }
+
+  // wait until the file with the given name is available locally, the mirrors of the following files being
+  // updated in the background. The caller must not hold the gate, which is needed by the mirror updates
+  void prepare(const std::string& fileName)
+  {
+    std::shared_future<std::string> localName;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if (mFileIndexes.count(fileName) == 0) return;
+      startReadAhead(fileName);
+      localName = getLocalName(fileName);
+    }
+    localName.wait();
+  }
+
+  // open file with the given name, or nullptr if the file cannot be opened
+  std::shared_ptr<TFile> get(const std::string& fileName)
+  {
+    std::shared_future<std::string> localName;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      for (auto it = mOpenFiles.begin(); it != mOpenFiles.end(); ++it) {
+        if (it->first == fileName) {
+          // most recently used files are kept at the front
+          mOpenFiles.splice(mOpenFiles.begin(), mOpenFiles, it);
+          return it->second;
+        }
+      }
+
+      startReadAhead(fileName);
+      localName = getLocalName(fileName);
+    }
+
+    // the mirror is updated and the file is opened without holding the lock, such that the other
+    // files of the pool remain accessible
+    std::shared_ptr<TFile> file;
+    if (!localName.get().empty()) {
+      file.reset(TFile::Open(localName.get().c_str()));
+    }
+    if (!file || file->IsZombie()) {
+      std::cout << "Cannot open ROOT file \"" << fileName << "\"" << std::endl;
+      return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mOpenFiles.emplace_front(fileName, file);
+    evict();
+    return file;
+  }
+
+  // close all the open files
+  void clear()
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mOpenFiles.clear();
+  }
+
+ private:
+  void evict()
+  {
+    while (mOpenFiles.size() > mMaxOpenFiles) {
+      mOpenFiles.pop_back();
+    }
+  }
+
+  // start the updates of the mirrors of the readAhead files registered after the given one
+  void startReadAhead(const std::string& fileName)
+  {
+    auto index = mFileIndexes.find(fileName);
+    if (index == mFileIndexes.end()) return;
+    for (size_t next = index->second + 1; next < mFileNames.size() && next <= index->second + mReadAhead; next++) {
+      getLocalName(mFileNames[next]);
+    }
+  }
+
+  // name of the local file from which a file is read, which is the mirror for the remote files.
+  // The update of the mirror is started in the background the first time the file is requested,
+  // and the name is empty if the mirror cannot be updated
+  std::shared_future<std::string> getLocalName(const std::string& fileName)
+  {
+    auto localName = mLocalNames.find(fileName);
+    if (localName != mLocalNames.end()) {
+      return localName->second;
+    }
+
+    std::shared_future<std::string> result;
+    if (!isRemoteInput(fileName) || mCacheDirectory.empty()) {
+      std::promise<std::string> name;
+      name.set_value(fileName);
+      result = name.get_future().share();
+    } else {
+      std::string mirrorFileName = getInputMirrorFileName(mCacheDirectory, fileName);
+      result = std::async(std::launch::async, [fileName, mirrorFileName, paths = mMirrorPaths, gate = mGate]() {
+                 std::shared_lock<PipelineGate> gateLock;
+                 if (gate) {
+                   gateLock = std::shared_lock<PipelineGate>(*gate);
+                 }
+                 return updateInputMirror(fileName, mirrorFileName, paths) ? mirrorFileName : std::string();
+               }).share();
+    }
+    mLocalNames[fileName] = result;
+    return result;
+  }
+
+  size_t mMaxOpenFiles;
+  std::vector<std::string> mFileNames;
+  std::map<std::string, size_t> mFileIndexes;
+  std::list<std::pair<std::string, std::shared_ptr<TFile>>> mOpenFiles;
+  std::string mCacheDirectory;
+  std::vector<std::string> mMirrorPaths;
+  size_t mReadAhead{ 0 };
+  PipelineGate* mGate{ nullptr };
+  std::map<std::string, std::shared_future<std::string>> mLocalNames;
+  std::mutex mMutex;
+};
+
+#endif // AQC_FILEPOOL_H_
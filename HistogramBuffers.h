@@ -0,0 +1,543 @@
+#ifndef AQC_HISTOGRAMBUFFERS_H_
+#define AQC_HISTOGRAMBUFFERS_H_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <TAxis.h>
+#include <TH1.h>
+#include <TH2.h>
+#include <TProfile.h>
+#include <TProfile2D.h>
+
+#include "./BinCheck.h"
+
+// Numerical operations on histogram bin contents stored in plain buffers.
+//
+// The bin values are extracted once from the input histograms, and the rebinning, normalization
+// and ratio operations are performed on the buffers without creating intermediate ROOT objects.
+// The buffers include the underflow and overflow bins, with the ROOT numbering convention.
+// TH1 objects are only created from the buffers when they need to be drawn.
+//
+// 2-D histograms can also be compared without projection ("xy" projection): the buffers then contain
+// all the cells of the histogram, with the global bin numbering of ROOT (ix + (nx + 2) * iy), and the
+// cells used in the normalization and in the checks are given as lists of global indexes.
+
+// Binning of a histogram axis, with fixed or variable bin widths
+struct AxisBinning
+{
+  int nBins{ 0 };
+  double xmin{ 0 };
+  double xmax{ 0 };
+  std::vector<double> edges; // empty for fixed bin widths
+
+  static AxisBinning fromAxis(const TAxis* axis)
+  {
+    AxisBinning binning;
+    binning.nBins = axis->GetNbins();
+    binning.xmin = axis->GetXmin();
+    binning.xmax = axis->GetXmax();
+    const TArrayD* bins = axis->GetXbins();
+    if (bins && bins->GetSize() > 0) {
+      binning.edges.assign(bins->GetArray(), bins->GetArray() + bins->GetSize());
+    }
+    return binning;
+  }
+
+  // binning obtained by merging groups of ngroup bins, with the same conventions as TH1::Rebin()
+  AxisBinning rebinned(int ngroup) const
+  {
+    if (ngroup <= 1) {
+      return *this;
+    }
+    AxisBinning binning;
+    binning.nBins = nBins / ngroup;
+    binning.xmin = xmin;
+    if (edges.empty()) {
+      binning.xmax = xmin + (xmax - xmin) * binning.nBins * ngroup / nBins;
+    } else {
+      for (int bin = 0; bin <= binning.nBins; bin++) {
+        binning.edges.push_back(edges[bin * ngroup]);
+      }
+      binning.xmax = binning.edges.back();
+    }
+    return binning;
+  }
+
+  int GetNbins() const { return nBins; }
+
+  std::vector<double> getEdges() const
+  {
+    if (!edges.empty()) {
+      return edges;
+    }
+    std::vector<double> result(nBins + 1);
+    for (int bin = 1; bin <= nBins + 1; bin++) {
+      result[bin - 1] = GetBinLowEdge(bin);
+    }
+    return result;
+  }
+
+  double GetBinLowEdge(int bin) const
+  {
+    return edges.empty() ? (xmin + (xmax - xmin) * (bin - 1) / nBins) : edges[bin - 1];
+  }
+
+  double GetBinCenter(int bin) const
+  {
+    return edges.empty() ? (xmin + (xmax - xmin) * (bin - 0.5) / nBins) : ((edges[bin - 1] + edges[bin]) / 2);
+  }
+
+  // same conventions as TAxis::FindBin()
+  int FindBin(double x) const
+  {
+    if (x < xmin) {
+      return 0;
+    }
+    if (!(x < xmax)) {
+      return nBins + 1;
+    }
+    if (edges.empty()) {
+      return 1 + static_cast<int>(nBins * (x - xmin) / (xmax - xmin));
+    }
+    return static_cast<int>(std::distance(edges.begin(), std::upper_bound(edges.begin(), edges.end(), x)));
+  }
+};
+
+// bin contents and errors, including underflow and overflow
+struct BinnedValues
+{
+  std::vector<double> content;
+  std::vector<double> error;
+
+  int getNbins() const { return static_cast<int>(content.size()) - 2; }
+};
+
+// Scratch buffers of a processing thread, reused for all the histograms processed by that thread
+// such that the memory is only allocated once
+struct RatioWorkspace
+{
+  BinnedValues numerator;
+  BinnedValues denominator;
+  BinnedValues ratio;
+  BinnedValues average;
+  // normalized values of all the histograms in a rate interval, stored histogram by histogram
+  std::vector<double> sampleContents;
+  std::vector<double> sampleErrors;
+  // same values, stored bin by bin
+  std::vector<double> binContents;
+  std::vector<double> binErrors;
+};
+
+// Region of interest of the 2-D comparisons: union of rectangles in the (x, y) plane, and/or
+// cells with non-zero content in a mask histogram
+struct RegionOfInterest
+{
+  std::vector<std::array<double, 4>> rectangles; // xmin, xmax, ymin, ymax
+  std::shared_ptr<TH2> mask;
+
+  bool empty() const { return rectangles.empty() && !mask; }
+
+  bool contains(double x, double y) const
+  {
+    for (auto& rectangle : rectangles) {
+      if (x >= rectangle[0] && x <= rectangle[1] && y >= rectangle[2] && y <= rectangle[3]) {
+        return true;
+      }
+    }
+    return mask && mask->GetBinContent(mask->FindFixBin(x, y)) != 0;
+  }
+};
+
+// Bin index ranges associated to the histograms of a given plot
+struct WindowBinning
+{
+  AxisBinning axis;         // binning of the (projected) histograms
+  AxisBinning rebinnedAxis; // binning after the rebinning
+  BinRange normalizationRange;
+  BinRange checkRange;
+
+  // 2-D comparisons: binning of the Y axis, and global indexes of the cells (after the rebinning)
+  // used in the normalization and in the checks
+  bool is2D{ false };
+  AxisBinning yAxis;
+  AxisBinning rebinnedYAxis;
+  std::vector<int> normalizationCells;
+  std::vector<int> checkCells;
+
+  // number of cells of the buffers before the rebinning, including underflow and overflow
+  size_t getNcells() const { return is2D ? size_t(axis.nBins + 2) * size_t(yAxis.nBins + 2) : size_t(axis.nBins + 2); }
+};
+
+// axis of the 1-D histogram used in the comparisons, taking into account the optional projection
+inline const TAxis* getProjectedAxis(const TH1* hist, const std::string& projection)
+{
+  if (!dynamic_cast<const TProfile*>(hist) && dynamic_cast<const TH2*>(hist) && projection == "y") {
+    return hist->GetYaxis();
+  }
+  return hist->GetXaxis();
+}
+
+// range of bins corresponding to TH1::Integral(FindBin(xmin), FindBin(xmax)), or to TH1::Integral() if xmin == xmax
+inline BinRange getNormalizationBinRange(const AxisBinning& axis, double xmin, double xmax)
+{
+  if (xmin != xmax) {
+    return BinRange{ std::max(axis.FindBin(xmin), 0), std::min(axis.FindBin(xmax), axis.nBins + 1) };
+  }
+  return BinRange{ 1, axis.nBins };
+}
+
+// whether the histogram is compared in 2-D, without projection
+inline bool is2DComparison(const TH1* hist, const std::string& projection)
+{
+  return (projection == "xy") && dynamic_cast<const TH2*>(hist);
+}
+
+// The check range applies to the X axis. In 2-D, the checked cells are further restricted to the
+// optional region of interest, while all the cells in the X range are used for the normalization
+inline WindowBinning getWindowBinning(const TH1* hist, const std::string& projection, int rebin, double checkRangeMin, double checkRangeMax,
+                                      const RegionOfInterest* roi = nullptr)
+{
+  WindowBinning binning;
+  binning.axis = AxisBinning::fromAxis(getProjectedAxis(hist, projection));
+  binning.rebinnedAxis = binning.axis.rebinned(rebin);
+  binning.normalizationRange = getNormalizationBinRange(binning.rebinnedAxis, checkRangeMin, checkRangeMax);
+  binning.checkRange = getCheckBinRange(&binning.rebinnedAxis, checkRangeMin, checkRangeMax);
+
+  if (is2DComparison(hist, projection)) {
+    binning.is2D = true;
+    binning.yAxis = AxisBinning::fromAxis(hist->GetYaxis());
+    binning.rebinnedYAxis = binning.yAxis.rebinned(rebin);
+
+    int nx = binning.rebinnedAxis.nBins;
+    int ny = binning.rebinnedYAxis.nBins;
+    bool useRoi = roi && !roi->empty();
+    for (int iy = 1; iy <= ny; iy++) {
+      for (int ix = binning.normalizationRange.first; ix <= binning.normalizationRange.last; ix++) {
+        binning.normalizationCells.push_back(ix + (nx + 2) * iy);
+      }
+      double y = binning.rebinnedYAxis.GetBinCenter(iy);
+      for (int ix = binning.checkRange.first; ix <= binning.checkRange.last; ix++) {
+        if (useRoi && !roi->contains(binning.rebinnedAxis.GetBinCenter(ix), y)) {
+          continue;
+        }
+        binning.checkCells.push_back(ix + (nx + 2) * iy);
+      }
+    }
+  }
+  return binning;
+}
+
+namespace histogram_buffers
+{
+
+template <typename T>
+void copyBins(const T* content, const TH1* hist, int nCells, BinnedValues& values)
+{
+  const double* sumw2 = (hist->GetSumw2N() > 0) ? hist->GetSumw2()->GetArray() : nullptr;
+  for (int bin = 0; bin < nCells; bin++) {
+    values.content[bin] = content[bin];
+    values.error[bin] = sumw2 ? std::sqrt(sumw2[bin]) : std::sqrt(std::fabs(double(content[bin])));
+  }
+}
+
+} // namespace histogram_buffers
+
+// Extract the bin values of the 1-D distribution used in the comparisons:
+// - profiles are converted to the mean value and its error in each bin, like TProfile::ProjectionX()
+// - 2-D histograms are projected into the requested axis, like TH2::ProjectionX/Y() including
+//   the underflow and overflow bins of the other axis
+// - the contents of other histograms are copied directly from their storage arrays
+// - with the "xy" projection, all the cells of 2-D histograms are copied
+inline void extractBins(const TH1* hist, const std::string& projection, BinnedValues& values)
+{
+  const TH2* h2 = dynamic_cast<const TH2*>(hist);
+  if (h2 && projection == "xy") {
+    int nCells = h2->GetNcells();
+    values.content.resize(nCells);
+    values.error.resize(nCells);
+    if (dynamic_cast<const TProfile2D*>(hist)) {
+      for (int cell = 0; cell < nCells; cell++) {
+        values.content[cell] = hist->GetBinContent(cell);
+        values.error[cell] = hist->GetBinError(cell);
+      }
+    } else if (auto* hd = dynamic_cast<const TArrayD*>(hist)) {
+      histogram_buffers::copyBins(hd->GetArray(), hist, nCells, values);
+    } else if (auto* hf = dynamic_cast<const TArrayF*>(hist)) {
+      histogram_buffers::copyBins(hf->GetArray(), hist, nCells, values);
+    } else {
+      for (int cell = 0; cell < nCells; cell++) {
+        values.content[cell] = hist->GetBinContent(cell);
+        values.error[cell] = hist->GetBinError(cell);
+      }
+    }
+    return;
+  }
+
+  if (h2 && (projection == "x" || projection == "y")) {
+    bool projectX = (projection == "x");
+    int nBins = projectX ? h2->GetNbinsX() : h2->GetNbinsY();
+    int nOther = projectX ? h2->GetNbinsY() : h2->GetNbinsX();
+    values.content.assign(nBins + 2, 0);
+    values.error.assign(nBins + 2, 0);
+    for (int bin = 0; bin <= nBins + 1; bin++) {
+      double sum = 0;
+      double sumErrors2 = 0;
+      for (int other = 0; other <= nOther + 1; other++) {
+        int globalBin = projectX ? h2->GetBin(bin, other) : h2->GetBin(other, bin);
+        double error = h2->GetBinError(globalBin);
+        sum += h2->GetBinContent(globalBin);
+        sumErrors2 += error * error;
+      }
+      values.content[bin] = sum;
+      values.error[bin] = std::sqrt(sumErrors2);
+    }
+    return;
+  }
+
+  int nBins = hist->GetXaxis()->GetNbins();
+  values.content.resize(nBins + 2);
+  values.error.resize(nBins + 2);
+
+  if (dynamic_cast<const TProfile*>(hist) || h2) {
+    for (int bin = 0; bin <= nBins + 1; bin++) {
+      values.content[bin] = hist->GetBinContent(bin);
+      values.error[bin] = hist->GetBinError(bin);
+    }
+  } else if (auto* hd = dynamic_cast<const TArrayD*>(hist)) {
+    histogram_buffers::copyBins(hd->GetArray(), hist, nBins + 2, values);
+  } else if (auto* hf = dynamic_cast<const TArrayF*>(hist)) {
+    histogram_buffers::copyBins(hf->GetArray(), hist, nBins + 2, values);
+  } else {
+    for (int bin = 0; bin <= nBins + 1; bin++) {
+      values.content[bin] = hist->GetBinContent(bin);
+      values.error[bin] = hist->GetBinError(bin);
+    }
+  }
+}
+
+// merge groups of ngroup bins in place, with the same conventions as TH1::Rebin():
+// the bins that do not form a complete group are added to the overflow
+inline void rebinValues(BinnedValues& values, int ngroup)
+{
+  if (ngroup <= 1) {
+    return;
+  }
+  int nBins = values.getNbins();
+  int nBinsNew = nBins / ngroup;
+  double overflow = values.content[nBins + 1];
+  double overflowErrors2 = values.error[nBins + 1] * values.error[nBins + 1];
+  for (int bin = nBinsNew * ngroup + 1; bin <= nBins; bin++) {
+    overflow += values.content[bin];
+    overflowErrors2 += values.error[bin] * values.error[bin];
+  }
+  for (int binNew = 1; binNew <= nBinsNew; binNew++) {
+    double sum = 0;
+    double sumErrors2 = 0;
+    for (int bin = (binNew - 1) * ngroup + 1; bin <= binNew * ngroup; bin++) {
+      sum += values.content[bin];
+      sumErrors2 += values.error[bin] * values.error[bin];
+    }
+    values.content[binNew] = sum;
+    values.error[binNew] = std::sqrt(sumErrors2);
+  }
+  values.content[nBinsNew + 1] = overflow;
+  values.error[nBinsNew + 1] = std::sqrt(overflowErrors2);
+  values.content.resize(nBinsNew + 2);
+  values.error.resize(nBinsNew + 2);
+}
+
+// merge groups of ngroup x ngroup cells of a 2-D histogram with nx x ny bins in place, with the same
+// conventions as TH2::Rebin2D(): the bins that do not form a complete group are added to the overflow.
+// The global index of the merged cell is never larger than the one of the original cell, therefore the
+// cells can be accumulated in place by scanning them in increasing order
+inline void rebinValues2D(BinnedValues& values, int nx, int ny, int ngroup)
+{
+  if (ngroup <= 1) {
+    return;
+  }
+  int nxNew = nx / ngroup;
+  int nyNew = ny / ngroup;
+  auto getNewBin = [ngroup](int bin, int nBinsNew) {
+    return (bin == 0) ? 0 : ((bin > nBinsNew * ngroup) ? (nBinsNew + 1) : ((bin - 1) / ngroup + 1));
+  };
+
+  // the errors of the already merged cells are accumulated in quadrature, and converted at the end
+  for (int iy = 0; iy <= ny + 1; iy++) {
+    int iyNew = getNewBin(iy, nyNew);
+    for (int ix = 0; ix <= nx + 1; ix++) {
+      int cell = ix + (nx + 2) * iy;
+      int cellNew = getNewBin(ix, nxNew) + (nxNew + 2) * iyNew;
+      double content = values.content[cell];
+      double error2 = values.error[cell] * values.error[cell];
+      values.content[cell] = 0;
+      values.error[cell] = 0;
+      values.content[cellNew] += content;
+      values.error[cellNew] += error2;
+    }
+  }
+
+  size_t nCellsNew = size_t(nxNew + 2) * size_t(nyNew + 2);
+  values.content.resize(nCellsNew);
+  values.error.resize(nCellsNew);
+  for (auto& error : values.error) {
+    error = std::sqrt(error);
+  }
+}
+
+// rebinning of the values of a plot, in 1-D or 2-D
+inline void rebinValues(BinnedValues& values, const WindowBinning& binning, int ngroup)
+{
+  if (binning.is2D) {
+    rebinValues2D(values, binning.axis.nBins, binning.yAxis.nBins, ngroup);
+  } else {
+    rebinValues(values, ngroup);
+  }
+}
+
+// inverse of the integral of the bins in the given range, or 1 if the integral is zero
+inline double getNormalizationFactor(const BinnedValues& values, BinRange range)
+{
+  double integral = 0;
+  int last = std::min(range.last, values.getNbins() + 1);
+  for (int bin = std::max(range.first, 0); bin <= last; bin++) {
+    integral += values.content[bin];
+  }
+  return ((integral == 0) ? 1.0 : 1.0 / integral);
+}
+
+// inverse of the integral of the given cells, or 1 if the integral is zero
+inline double getNormalizationFactor(const BinnedValues& values, const std::vector<int>& cells)
+{
+  double integral = 0;
+  for (int cell : cells) {
+    integral += values.content[cell];
+  }
+  return ((integral == 0) ? 1.0 : 1.0 / integral);
+}
+
+// normalization factor of the rebinned values of a plot, in 1-D or 2-D
+inline double getNormalizationFactor(const BinnedValues& values, const WindowBinning& binning)
+{
+  return binning.is2D ? getNormalizationFactor(values, binning.normalizationCells) : getNormalizationFactor(values, binning.normalizationRange);
+}
+
+inline void scaleValues(BinnedValues& values, double factor)
+{
+  for (size_t bin = 0; bin < values.content.size(); bin++) {
+    values.content[bin] *= factor;
+    values.error[bin] *= factor;
+  }
+}
+
+// bin-by-bin ratio with uncorrelated errors, like TH1::Divide()
+inline void divideValues(const BinnedValues& numerator, const BinnedValues& denominator, BinnedValues& ratio)
+{
+  size_t nCells = numerator.content.size();
+  ratio.content.resize(nCells);
+  ratio.error.resize(nCells);
+  for (size_t bin = 0; bin < nCells; bin++) {
+    double c1 = numerator.content[bin];
+    double c2 = denominator.content[bin];
+    if (c2 == 0) {
+      ratio.content[bin] = 0;
+      ratio.error[bin] = 0;
+      continue;
+    }
+    double e1 = numerator.error[bin];
+    double e2 = denominator.error[bin];
+    ratio.content[bin] = c1 / c2;
+    ratio.error[bin] = std::sqrt(e1 * e1 * c2 * c2 + e2 * e2 * c1 * c1) / (c2 * c2);
+  }
+}
+
+// rebinned and normalized values of a histogram, as used in the comparisons
+inline void getComparisonValues(const TH1* hist, const std::string& projection, int rebin, bool normalize,
+                                const WindowBinning& binning, BinnedValues& values)
+{
+  extractBins(hist, projection, values);
+  rebinValues(values, binning, rebin);
+  if (normalize) {
+    scaleValues(values, getNormalizationFactor(values, binning));
+  }
+}
+
+// check the bins of a ratio stored in a buffer
+inline BinCheckResult checkRatioValues(const BinnedValues& ratio, BinRange range, const BinCheckParameters& parameters)
+{
+  range.last = std::min(range.last, ratio.getNbins());
+  return checkRatioBins(ValueErrorStorage{ ratio.content.data(), ratio.error.data() }, range, parameters);
+}
+
+// check the bins or cells of the ratio of a plot, in 1-D or 2-D.
+// In 2-D, the elements of badCells corresponding to the bad cells are incremented if badCells is not null
+inline BinCheckResult checkRatioValues(const BinnedValues& ratio, const WindowBinning& binning, const BinCheckParameters& parameters,
+                                       double* badCells = nullptr)
+{
+  if (binning.is2D) {
+    return checkRatioCells(ValueErrorStorage{ ratio.content.data(), ratio.error.data() }, binning.checkCells, parameters, badCells);
+  }
+  return checkRatioValues(ratio, binning.checkRange, parameters);
+}
+
+// create a histogram from the given bin values, to be used for drawing
+inline TH1* makeHistogram(const char* name, const char* title, const AxisBinning& axis, const BinnedValues& values)
+{
+  TH1* hist = axis.edges.empty() ? new TH1D(name, title, axis.nBins, axis.xmin, axis.xmax) :
+                                   new TH1D(name, title, axis.nBins, axis.edges.data());
+  hist->Sumw2();
+  int nCells = std::min(axis.nBins + 2, static_cast<int>(values.content.size()));
+  for (int bin = 0; bin < nCells; bin++) {
+    hist->SetBinContent(bin, values.content[bin]);
+    hist->SetBinError(bin, values.error[bin]);
+  }
+  return hist;
+}
+
+// create a histogram from the bin values extracted from the source histogram, with the same titles
+inline TH1* makeHistogram(const char* name, const TH1* source, const std::string& projection,
+                          const AxisBinning& axis, const BinnedValues& values)
+{
+  TH1* hist = makeHistogram(name, source->GetTitle(), axis, values);
+  const TAxis* sourceAxis = getProjectedAxis(source, projection);
+  hist->GetXaxis()->SetTitle(sourceAxis->GetTitle());
+  if (source->GetDimension() == 1) {
+    hist->GetYaxis()->SetTitle(source->GetYaxis()->GetTitle());
+  }
+  return hist;
+}
+
+// create a 2-D histogram from the given cell values, to be used for drawing
+inline TH2* makeHistogram2D(const char* name, const char* title, const AxisBinning& xAxis, const AxisBinning& yAxis,
+                            const BinnedValues& values)
+{
+  auto xEdges = xAxis.getEdges();
+  auto yEdges = yAxis.getEdges();
+  TH2* hist = new TH2D(name, title, xAxis.nBins, xEdges.data(), yAxis.nBins, yEdges.data());
+  hist->Sumw2();
+  int nCells = std::min(hist->GetNcells(), static_cast<int>(values.content.size()));
+  for (int cell = 0; cell < nCells; cell++) {
+    hist->SetBinContent(cell, values.content[cell]);
+    hist->SetBinError(cell, values.error[cell]);
+  }
+  return hist;
+}
+
+// create a 1-D or 2-D histogram from the (rebinned) values of a plot, with the same titles as the source histogram
+inline TH1* makeHistogram(const char* name, const TH1* source, const std::string& projection,
+                          const WindowBinning& binning, const BinnedValues& values)
+{
+  if (!binning.is2D) {
+    return makeHistogram(name, source, projection, binning.rebinnedAxis, values);
+  }
+  TH1* hist = makeHistogram2D(name, source->GetTitle(), binning.rebinnedAxis, binning.rebinnedYAxis, values);
+  hist->GetXaxis()->SetTitle(source->GetXaxis()->GetTitle());
+  hist->GetYaxis()->SetTitle(source->GetYaxis()->GetTitle());
+  return hist;
+}
+
+#endif // AQC_HISTOGRAMBUFFERS_H_
@@ -0,0 +1,220 @@
+#ifndef AQC_INPUTMIRROR_H_
+#define AQC_INPUTMIRROR_H_
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <TDirectory.h>
+#include <TFile.h>
+#include <TKey.h>
+#include <TList.h>
+#include <TNamed.h>
+#include <TSystem.h>
+#include <TUUID.h>
+
+// Local mirrors of remote input files.
+//
+// The QC files can be read directly from their URL (root://, https://, file://, ...) instead of being
+// downloaded. Only the objects needed by the configured plots are read from the remote file, and copied
+// into a local mirror file with the same layout, from which the plots are then extracted. They are given
+// by path, for example "mw/DETECTOR/TASK", which is either a key, like the collections of the MOs of a
+// task, or a directory whose keys are all copied. The keys are fetched with vectored reads, such that a
+// directory costs a few requests instead of one per key.
+// The mirror records the UUID of the remote file, and the paths whose copy is complete: the paths already
+// copied are served locally as long as the remote file is not replaced. A path that does not exist in the
+// remote file is recorded as well, such that it is not requested again, while a path whose keys cannot
+// be read is not recorded, and is copied again by the next processing.
+
+// maximum size of the keys fetched with a single vectored read
+constexpr Long64_t kMirrorReadBlockSize = 64 * 1024 * 1024;
+
+inline bool isRemoteInput(const std::string& name)
+{
+  return name.find("://") != std::string::npos;
+}
+
+// path of the mirror of a URL in the cache directory, built from the host and path of the URL
+inline std::string getInputMirrorFileName(const std::string& cacheDirectory, const std::string& url)
+{
+  std::string path = url.substr(url.find("://") + 3);
+  path = path.substr(0, path.find('?'));
+  std::replace(path.begin(), path.end(), ':', '_');
+  std::string fileName = cacheDirectory;
+  for (auto c : "/" + path) {
+    // the URLs contain double slashes between the host and the absolute path
+    if (c == '/' && !fileName.empty() && fileName.back() == '/') continue;
+    fileName += c;
+  }
+  return fileName;
+}
+
+// URL of the input files of a run, from a pattern containing the {year}, {period}, {pass} and {run} placeholders
+inline std::string expandInputURL(std::string pattern, const std::string& year, const std::string& period,
+                                  const std::string& pass, int run)
+{
+  for (auto [placeholder, value] : { std::make_pair("{year}", year), std::make_pair("{period}", period),
+                                     std::make_pair("{pass}", pass), std::make_pair("{run}", std::to_string(run)) }) {
+    for (auto position = pattern.find(placeholder); position != std::string::npos; position = pattern.find(placeholder)) {
+      pattern.replace(position, std::string(placeholder).size(), value);
+    }
+  }
+  return pattern;
+}
+
+// paths whose copy is complete, as recorded in the mirror
+inline std::set<std::string> getMirrorContents(TFile* mirrorFile)
+{
+  std::set<std::string> contents;
+  std::unique_ptr<TNamed> record{ mirrorFile->Get<TNamed>("aqcMirrorContents") };
+  if (record) {
+    std::istringstream paths(record->GetTitle());
+    for (std::string path; std::getline(paths, path);) {
+      contents.insert(path);
+    }
+  }
+  return contents;
+}
+
+inline void writeMirrorContents(TFile* mirrorFile, const std::set<std::string>& contents)
+{
+  std::string paths;
+  for (const auto& path : contents) {
+    paths += path + "\n";
+  }
+  TNamed record("aqcMirrorContents", paths.c_str());
+  mirrorFile->WriteTObject(&record, record.GetName(), "Overwrite");
+}
+
+// copy keys of the remote file into one directory of the mirror. Returns false if the keys cannot be read
+inline bool copyMirrorKeys(TFile* remoteFile, const std::vector<TKey*>& keys, TDirectory* mirrorDir, const std::string& path)
+{
+  std::vector<char> buffer;
+  std::vector<Long64_t> positions;
+  std::vector<Int_t> lengths;
+  for (size_t first = 0; first < keys.size();) {
+    // group the following keys into a vectored read of at most kMirrorReadBlockSize bytes
+    positions.clear();
+    lengths.clear();
+    Long64_t size = 0;
+    size_t last = first;
+    while (last < keys.size() && (last == first || size + keys[last]->GetNbytes() <= kMirrorReadBlockSize)) {
+      positions.push_back(keys[last]->GetSeekKey());
+      lengths.push_back(keys[last]->GetNbytes());
+      size += keys[last]->GetNbytes();
+      last += 1;
+    }
+    buffer.resize(size);
+    if (remoteFile->ReadBuffers(buffer.data(), positions.data(), lengths.data(), positions.size())) {
+      std::cout << "Failed to read the keys of \"" << path << "\"" << std::endl;
+      return false;
+    }
+
+    Long64_t offset = 0;
+    for (size_t index = first; index < last; index++) {
+      std::unique_ptr<TObject> object{ keys[index]->ReadObjWithBuffer(buffer.data() + offset) };
+      offset += keys[index]->GetNbytes();
+      if (object) {
+        // the keys left by an interrupted copy are replaced
+        mirrorDir->WriteTObject(object.get(), keys[index]->GetName(), "Overwrite");
+      }
+    }
+    first = last;
+  }
+  return true;
+}
+
+// copy one path of the remote file into the mirror, nothing being copied if the path does not exist.
+// Returns false if its keys cannot be read
+inline bool copyMirrorPath(TFile* remoteFile, TFile* mirrorFile, const std::string& path)
+{
+  std::vector<TKey*> keys;
+  std::string mirrorDirName;
+  if (TDirectory* remoteDir = remoteFile->GetDirectory(path.c_str())) {
+    // only the latest cycle of each key is copied
+    std::set<std::string> names;
+    for (TObject* object : *remoteDir->GetListOfKeys()) {
+      auto* key = dynamic_cast<TKey*>(object);
+      if (key && names.insert(key->GetName()).second) {
+        keys.push_back(key);
+      }
+    }
+    mirrorDirName = path;
+  } else if (auto separator = path.rfind('/'); separator != std::string::npos) {
+    TDirectory* remoteDir = remoteFile->GetDirectory(path.substr(0, separator).c_str());
+    TKey* key = remoteDir ? remoteDir->GetKey(path.substr(separator + 1).c_str()) : nullptr;
+    if (key) {
+      keys.push_back(key);
+    }
+    mirrorDirName = path.substr(0, separator);
+  } else if (TKey* key = remoteFile->GetKey(path.c_str())) {
+    keys.push_back(key);
+  }
+  if (keys.empty()) {
+    return true;
+  }
+
+  TDirectory* mirrorDir = mirrorDirName.empty() ? mirrorFile : mirrorFile->mkdir(mirrorDirName.c_str(), "", kTRUE);
+  return mirrorDir && copyMirrorKeys(remoteFile, keys, mirrorDir, path);
+}
+
+// copy the paths that are missing from the mirror. Returns false if the remote file or one of its
+// paths cannot be read
+inline bool updateInputMirror(const std::string& url, const std::string& mirrorFileName, const std::vector<std::string>& paths)
+{
+  std::unique_ptr<TFile> remoteFile{ TFile::Open(url.c_str()) };
+  if (!remoteFile || remoteFile->IsZombie()) {
+    // a complete mirror is still used if the remote file is not reachable
+    std::unique_ptr<TFile> mirrorFile{ gSystem->AccessPathName(mirrorFileName.c_str()) ? nullptr : TFile::Open(mirrorFileName.c_str()) };
+    bool complete = false;
+    if (mirrorFile && !mirrorFile->IsZombie()) {
+      auto contents = getMirrorContents(mirrorFile.get());
+      complete = std::all_of(paths.begin(), paths.end(), [&](const std::string& path) { return contents.count(path) > 0; });
+    }
+    std::cout << "Cannot open remote file \"" << url << "\"" << (complete ? ", using its local mirror" : "") << std::endl;
+    return complete;
+  }
+  std::string uuid = remoteFile->GetUUID().AsString();
+
+  gSystem->mkdir(gSystem->GetDirName(mirrorFileName.c_str()).Data(), kTRUE);
+  std::unique_ptr<TFile> mirrorFile{ TFile::Open(mirrorFileName.c_str(), "UPDATE") };
+  if (!mirrorFile || mirrorFile->IsZombie()) {
+    std::cout << "Cannot open mirror file \"" << mirrorFileName << "\"" << std::endl;
+    return false;
+  }
+  std::unique_ptr<TNamed> source{ mirrorFile->Get<TNamed>("aqcMirrorSource") };
+  if (source && uuid != source->GetTitle()) {
+    std::cout << "Remote file \"" << url << "\" has changed, re-creating its mirror" << std::endl;
+    source.reset();
+    mirrorFile.reset();
+    mirrorFile.reset(TFile::Open(mirrorFileName.c_str(), "RECREATE"));
+    if (!mirrorFile || mirrorFile->IsZombie()) {
+      return false;
+    }
+  }
+  if (!source) {
+    TNamed sourceInfo("aqcMirrorSource", uuid.c_str());
+    mirrorFile->WriteTObject(&sourceInfo, sourceInfo.GetName(), "Overwrite");
+  }
+
+  auto contents = getMirrorContents(mirrorFile.get());
+  for (const auto& path : paths) {
+    if (contents.count(path) > 0) continue;
+    std::cout << "Copying \"" << path << "\" from " << url << std::endl;
+    if (!copyMirrorPath(remoteFile.get(), mirrorFile.get(), path)) {
+      mirrorFile->Close();
+      return false;
+    }
+    // the path is only recorded once its copy is complete
+    contents.insert(path);
+    writeMirrorContents(mirrorFile.get(), contents);
+  }
+  mirrorFile->Close();
+  return true;
+}
+
+#endif // AQC_INPUTMIRROR_H_
@@ -0,0 +1,73 @@
+#ifndef AQC_PARALLELFOR_H_
+#define AQC_PARALLELFOR_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// number of worker threads to be used when the requested number is zero
+inline size_t getDefaultNumberOfThreads()
+{
+  size_t nThreads = std::thread::hardware_concurrency();
+  return (nThreads > 0) ? nThreads : 1;
+}
+
+// Execute func(taskIndex, workerIndex) for each taskIndex in [0, nTasks), distributing the tasks
+// dynamically over nWorkers threads. The workerIndex is in [0, nWorkers) and can be used to
+// access per-worker resources without locking.
+// The first exception thrown by a task, if any, is re-thrown once all the workers are finished.
+template <class Func>
+void parallelFor(size_t nTasks, size_t nWorkers, Func&& func)
+{
+  if (nWorkers == 0) {
+    nWorkers = getDefaultNumberOfThreads();
+  }
+  nWorkers = std::min(nWorkers, nTasks);
+
+  // no need to spawn threads for a single worker
+  if (nWorkers <= 1) {
+    for (size_t taskIndex = 0; taskIndex < nTasks; taskIndex++) {
+      func(taskIndex, size_t(0));
+    }
+    return;
+  }
+
+  std::atomic<size_t> nextTask{ 0 };
+  std::exception_ptr firstException;
+  std::mutex exceptionMutex;
+
+  auto worker = [&](size_t workerIndex) {
+    while (true) {
+      size_t taskIndex = nextTask.fetch_add(1);
+      if (taskIndex >= nTasks) {
+        break;
+      }
+      try {
+        func(taskIndex, workerIndex);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(exceptionMutex);
+        if (!firstException) {
+          firstException = std::current_exception();
+        }
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t workerIndex = 0; workerIndex < nWorkers; workerIndex++) {
+    workers.emplace_back(worker, workerIndex);
+  }
+  for (auto& thread : workers) {
+    thread.join();
+  }
+
+  if (firstException) {
+    std::rethrow_exception(firstException);
+  }
+}
+
+#endif // AQC_PARALLELFOR_H_
@@ -0,0 +1,115 @@
+#ifndef AQC_PDFPAGES_H_
+#define AQC_PDFPAGES_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <ROOT/TProcessExecutor.hxx>
+#include <ROOT/TSeq.hxx>
+#include <TString.h>
+#include <TSystem.h>
+
+#include "./ParallelFor.h"
+
+// Rendering of multi-page PDF files with a pool of worker processes.
+//
+// The pages are split into contiguous blocks, each rendered by a separate process into a temporary
+// PDF file, and the blocks are then concatenated in order into the final file.
+// The processes are forked from the main one, such that the page descriptions do not need to be
+// serialized. The rendering is done serially if the PDF files cannot be concatenated.
+
+// minimum number of pages rendered by each worker process, to limit the overhead of the merging
+constexpr size_t kMinPagesPerPdfWorker = 4;
+
+// file name to be passed to TCanvas::SaveAs() to write the page with index pageIndex, out of the pages in
+// [first, last), into a single multi-page PDF file
+inline std::string getPdfPageFileName(const std::string& fileName, size_t pageIndex, size_t first, size_t last)
+{
+  if (last - first == 1) {
+    return fileName;
+  }
+  if (pageIndex == first) {
+    return fileName + "(";
+  }
+  if (pageIndex + 1 == last) {
+    return fileName + ")";
+  }
+  return fileName;
+}
+
+namespace pdf_pages
+{
+
+inline bool hasExecutable(const char* name)
+{
+  TString path(name);
+  return (gSystem->FindFile(gSystem->Getenv("PATH"), path, kExecutePermission) != nullptr);
+}
+
+} // namespace pdf_pages
+
+// command concatenating the input PDF files into the output one, empty if no suitable tool is installed
+inline std::string getPdfMergeCommand(const std::vector<std::string>& inputs, const std::string& output)
+{
+  std::string inputList;
+  for (auto& input : inputs) {
+    inputList += std::string(" \"") + input + "\"";
+  }
+
+  if (pdf_pages::hasExecutable("pdfunite")) {
+    return std::string("pdfunite") + inputList + " \"" + output + "\"";
+  }
+  if (pdf_pages::hasExecutable("qpdf")) {
+    return std::string("qpdf --empty --pages") + inputList + " -- \"" + output + "\"";
+  }
+  if (pdf_pages::hasExecutable("gs")) {
+    return std::string("gs -q -dNOPAUSE -dBATCH -sDEVICE=pdfwrite -sOutputFile=\"") + output + "\"" + inputList;
+  }
+  return {};
+}
+
+// Render nPages pages into the given PDF file, using up to nWorkers processes (zero meaning one per available core).
+// renderRange(first, last, fileName) must draw the pages in [first, last) into fileName, using
+// getPdfPageFileName() for the names passed to TCanvas::SaveAs()
+template <class RenderRange>
+void renderPdfPages(const std::string& fileName, size_t nPages, size_t nWorkers, RenderRange&& renderRange)
+{
+  if (nWorkers == 0) {
+    nWorkers = getDefaultNumberOfThreads();
+  }
+  size_t nBlocks = std::min(nWorkers, nPages / kMinPagesPerPdfWorker);
+
+  std::vector<std::string> blockFileNames;
+  for (size_t block = 0; block < nBlocks; block++) {
+    blockFileNames.push_back(fileName + ".part" + std::to_string(block) + ".pdf");
+  }
+  std::string mergeCommand = (nBlocks > 1) ? getPdfMergeCommand(blockFileNames, fileName) : std::string();
+
+  if (mergeCommand.empty()) {
+    renderRange(size_t(0), nPages, fileName);
+    return;
+  }
+
+  auto getBlockStart = [&](size_t block) { return block * nPages / nBlocks; };
+
+  ROOT::TProcessExecutor pool(nBlocks);
+  auto status = pool.Map([&](int block) {
+    renderRange(getBlockStart(block), getBlockStart(block + 1), blockFileNames[block]);
+    return 0;
+  }, ROOT::TSeqI(nBlocks));
+
+  bool success = (status.size() == nBlocks) && (gSystem->Exec(mergeCommand.c_str()) == 0);
+  for (auto& blockFileName : blockFileNames) {
+    gSystem->Unlink(blockFileName.c_str());
+  }
+
+  if (!success) {
+    std::cout << "Parallel rendering of \"" << fileName << "\" failed, rendering the pages serially" << std::endl;
+    renderRange(size_t(0), nPages, fileName);
+  }
+}
+
+#endif // AQC_PDFPAGES_H_
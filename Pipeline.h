@@ -0,0 +1,166 @@
+#ifndef AQC_PIPELINE_H_
+#define AQC_PIPELINE_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
+
+// Building blocks of the processing pipeline.
+//
+// Each stage runs in its own thread, and consumes the items produced by the previous stage from a
+// bounded queue. The producers are blocked while the queue is full, such that the number of items
+// held in memory between two stages never exceeds the capacity of the queue.
+// Closing a queue wakes up all the waiting threads: the consumers receive the items still in the
+// queue and then an empty value, while the producers cannot push new items anymore. A stage that
+// terminates, normally or because of an exception, closes its queues such that the other stages
+// are not blocked forever.
+
+template <class T>
+class BoundedQueue
+{
+ public:
+  explicit BoundedQueue(size_t capacity) : mCapacity(capacity > 0 ? capacity : 1) {}
+
+  // add an item, waiting while the queue is full. Returns false if the queue has been closed
+  bool push(T item)
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mNotFull.wait(lock, [this] { return mClosed || mItems.size() < mCapacity; });
+    if (mClosed) {
+      return false;
+    }
+    mItems.push_back(std::move(item));
+    mNotEmpty.notify_one();
+    return true;
+  }
+
+  // remove the oldest item, waiting while the queue is empty. Returns an empty value once the
+  // queue is closed and all the items have been consumed
+  std::optional<T> pop()
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mNotEmpty.wait(lock, [this] { return mClosed || !mItems.empty(); });
+    if (mItems.empty()) {
+      return std::nullopt;
+    }
+    T item = std::move(mItems.front());
+    mItems.pop_front();
+    mNotFull.notify_one();
+    return item;
+  }
+
+  void close()
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mClosed = true;
+    mNotEmpty.notify_all();
+    mNotFull.notify_all();
+  }
+
+ private:
+  size_t mCapacity;
+  bool mClosed{ false };
+  std::deque<T> mItems;
+  std::mutex mMutex;
+  std::condition_variable mNotEmpty;
+  std::condition_variable mNotFull;
+};
+
+// Lock used to pause the stages of the pipeline. The stages hold it in shared mode while they process
+// an item, with std::shared_lock, and the main thread holds it in exclusive mode, with std::unique_lock,
+// while the stages must not run. Contrary to std::shared_mutex, a pending exclusive request has priority
+// over the new shared requests, such that the stages cannot delay the main thread indefinitely
+class PipelineGate
+{
+ public:
+  void lock_shared()
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mChanged.wait(lock, [this] { return !mPaused; });
+    mActive += 1;
+  }
+
+  void unlock_shared()
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mActive -= 1;
+    mChanged.notify_all();
+  }
+
+  void lock()
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mChanged.wait(lock, [this] { return !mPaused; });
+    mPaused = true;
+    mChanged.wait(lock, [this] { return mActive == 0; });
+  }
+
+  void unlock()
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPaused = false;
+    mChanged.notify_all();
+  }
+
+ private:
+  std::mutex mMutex;
+  std::condition_variable mChanged;
+  int mActive{ 0 };
+  bool mPaused{ false };
+};
+
+// Thread executing one stage of the pipeline. onExit() is called when func() returns or throws,
+// and is used to close the queues connected to the stage. It is also called by the destructor if the
+// stage was not joined, such that a stage blocked on its queues terminates when the thread owning it
+// leaves the pipeline because of an exception.
+// The exception thrown by func(), if any, is re-thrown by join()
+class PipelineStage
+{
+ public:
+  PipelineStage(std::function<void()> func, std::function<void()> onExit) : mOnExit(std::move(onExit))
+  {
+    mThread = std::thread([this, func = std::move(func)]() {
+      try {
+        func();
+      } catch (...) {
+        mException = std::current_exception();
+      }
+      mOnExit();
+    });
+  }
+
+  PipelineStage(const PipelineStage&) = delete;
+  PipelineStage& operator=(const PipelineStage&) = delete;
+
+  ~PipelineStage()
+  {
+    if (mThread.joinable()) {
+      mOnExit();
+      mThread.join();
+    }
+  }
+
+  void join()
+  {
+    if (mThread.joinable()) {
+      mThread.join();
+    }
+    if (mException) {
+      std::rethrow_exception(std::exchange(mException, nullptr));
+    }
+  }
+
+ private:
+  std::function<void()> mOnExit;
+  std::thread mThread;
+  std::exception_ptr mException;
+};
+
+#endif // AQC_PIPELINE_H_
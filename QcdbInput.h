@@ -0,0 +1,221 @@
+#ifndef AQC_QCDBINPUT_H_
+#define AQC_QCDBINPUT_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <TFile.h>
+#include <TSystem.h>
+#include <QualityControl/MonitorObject.h>
+#include "QualityControl/ObjectMetadataKeys.h"
+#include "QualityControl/CcdbDatabase.h"
+
+#include "./ParallelFor.h"
+
+// Input backend reading the moving-window objects of the plots directly from the QCDB, instead of the QC files.
+//
+// The time windows of a plot are the versions of its moving-window object, which are listed for each run with
+// the run, period and pass metadata, and then retrieved one by one at the middle of their validity. The requests
+// are distributed over several connections to the database. Each retrieved object is stored in an on-disk cache,
+// keyed by the object path, the run and the validity and creation time of the version, such that the following
+// processings only retrieve the new or re-uploaded time windows.
+// The URL of the database can point to any server implementing the CCDB REST interface, for example a local
+// server serving recorded objects.
+class QcdbInput
+{
+ public:
+  QcdbInput() = default;
+  QcdbInput(const QcdbInput&) = delete;
+  QcdbInput& operator=(const QcdbInput&) = delete;
+
+  // the path pattern contains the {prefix}, {detector}, {task} and {plot} placeholders
+  void configure(const std::string& url, const std::string& prefix, const std::string& pathPattern, const std::string& period,
+                 const std::string& pass, const std::string& cacheDirectory, size_t nConnections)
+  {
+    mUrl = url;
+    mPrefix = prefix;
+    mPathPattern = pathPattern;
+    mPeriod = period;
+    mPass = pass;
+    mCacheDirectory = cacheDirectory;
+    mConnections.clear();
+    mConnections.resize((nConnections > 0) ? nConnections : 1);
+  }
+
+  bool isEnabled() const { return !mUrl.empty(); }
+
+  // name under which the run is listed with the input files, and run of such a name (zero for the other inputs)
+  static std::string getInputName(int run) { return "qcdb:" + std::to_string(run); }
+  static int getInputRun(const std::string& name)
+  {
+    return (name.rfind("qcdb:", 0) == 0) ? std::stoi(name.substr(5)) : 0;
+  }
+
+  // MOs of the time windows of one run, for several plots of the same detector and task.
+  // The MOs of plotNames[i] are returned in the i-th element of the result
+  std::vector<std::vector<std::shared_ptr<o2::quality_control::core::MonitorObject>>> getMovingWindows(
+    int run, const std::string& detector, const std::string& task, const std::vector<std::string>& plotNames)
+  {
+    std::vector<std::vector<std::shared_ptr<o2::quality_control::core::MonitorObject>>> result(plotNames.size());
+
+    // the plots listed several times are only retrieved once
+    std::vector<WindowRequest> requests;
+    std::map<std::string, size_t> firstPlots;
+    for (size_t plotIndex = 0; plotIndex < plotNames.size(); plotIndex++) {
+      if (!firstPlots.try_emplace(plotNames[plotIndex], plotIndex).second) continue;
+      std::string path = getPath(detector, task, plotNames[plotIndex]);
+      auto listing = getConnection(0).getListingAsPtree(path, getMetadata(run), false);
+      if (listing.count("objects") == 0 || listing.get_child("objects").empty()) {
+        std::cout << "No time window found in the QCDB for \"" << path << "\", run " << run << std::endl;
+        continue;
+      }
+      // the listing contains all the versions, and a time window that was uploaded again is only retrieved
+      // once, from its latest version
+      std::map<std::pair<uint64_t, uint64_t>, uint64_t> windows;
+      for (const auto& [key, object] : listing.get_child("objects")) {
+        namespace keys = o2::quality_control::repository::metadata_keys;
+        auto& created = windows[{ object.get<uint64_t>(keys::validFrom), object.get<uint64_t>(keys::validUntil) }];
+        created = std::max(created, object.get<uint64_t>(keys::created));
+      }
+      for (const auto& [validity, created] : windows) {
+        requests.push_back({ plotIndex, path, validity.first, validity.second, created });
+      }
+    }
+
+    std::vector<std::shared_ptr<o2::quality_control::core::MonitorObject>> mos(requests.size());
+    parallelFor(requests.size(), mConnections.size(), [&](size_t requestIndex, size_t worker) {
+      mos[requestIndex] = retrieve(requests[requestIndex], run, detector, task, worker);
+    });
+
+    for (size_t requestIndex = 0; requestIndex < requests.size(); requestIndex++) {
+      if (!mos[requestIndex]) continue;
+      size_t firstPlot = requests[requestIndex].plot;
+      result[firstPlot].push_back(mos[requestIndex]);
+      // the other plots get their own copy, since the MOs of the same time window are added together
+      for (size_t plotIndex = firstPlot + 1; plotIndex < plotNames.size(); plotIndex++) {
+        if (plotNames[plotIndex] == plotNames[firstPlot]) {
+          result[plotIndex].emplace_back(dynamic_cast<o2::quality_control::core::MonitorObject*>(mos[requestIndex]->Clone()));
+        }
+      }
+    }
+    return result;
+  }
+
+ private:
+  // version of a moving-window object, corresponding to one time window
+  struct WindowRequest
+  {
+    size_t plot;
+    std::string path;
+    uint64_t validFrom;
+    uint64_t validUntil;
+    uint64_t created;
+  };
+
+  std::string getPath(const std::string& detector, const std::string& task, const std::string& plot) const
+  {
+    std::string path = mPathPattern;
+    for (auto [placeholder, value] : { std::make_pair("{prefix}", mPrefix), std::make_pair("{detector}", detector),
+                                       std::make_pair("{task}", task), std::make_pair("{plot}", plot) }) {
+      for (auto position = path.find(placeholder); position != std::string::npos; position = path.find(placeholder)) {
+        path.replace(position, std::string(placeholder).size(), value);
+      }
+    }
+    return path;
+  }
+
+  std::map<std::string, std::string> getMetadata(int run) const
+  {
+    namespace keys = o2::quality_control::repository::metadata_keys;
+    std::map<std::string, std::string> metadata;
+    metadata[keys::runNumber] = std::to_string(run);
+    metadata[keys::periodName] = mPeriod;
+    if (!mPass.empty()) {
+      metadata[keys::passName] = mPass;
+    }
+    return metadata;
+  }
+
+  // connection used by one worker, opened on first use
+  o2::quality_control::repository::CcdbDatabase& getConnection(size_t worker)
+  {
+    auto& connection = mConnections[worker];
+    if (!connection) {
+      connection = std::make_unique<o2::quality_control::repository::CcdbDatabase>();
+      connection->connect(mUrl, "", "", "");
+    }
+    return *connection;
+  }
+
+  std::string getCacheFileName(const WindowRequest& request, int run) const
+  {
+    return mCacheDirectory + "/" + request.path + "/" + std::to_string(run) + "/" + std::to_string(request.validFrom) + "-" +
+           std::to_string(request.validUntil) + "-" + std::to_string(request.created) + ".root";
+  }
+
+  std::shared_ptr<o2::quality_control::core::MonitorObject> retrieve(const WindowRequest& request, int run, const std::string& detector,
+                                                                     const std::string& task, size_t worker)
+  {
+    using o2::quality_control::core::MonitorObject;
+    std::string cacheFileName = getCacheFileName(request, run);
+    if (!gSystem->AccessPathName(cacheFileName.c_str())) {
+      std::unique_ptr<TFile> cacheFile{ TFile::Open(cacheFileName.c_str()) };
+      if (cacheFile && !cacheFile->IsZombie()) {
+        if (auto* mo = cacheFile->Get<MonitorObject>("mo")) {
+          mo->setIsOwner(true);
+          return std::shared_ptr<MonitorObject>(mo);
+        }
+      }
+      std::cout << "Invalid cached object \"" << cacheFileName << "\", retrieving it again" << std::endl;
+    }
+
+    // the version is selected by a time stamp inside its validity
+    long timestamp = static_cast<long>(request.validFrom + (request.validUntil - request.validFrom) / 2);
+    TObject* object = getConnection(worker).retrieveTObject(request.path, getMetadata(run), timestamp);
+    if (!object) {
+      std::cout << "Cannot retrieve \"" << request.path << "\" for run " << run << " at " << timestamp << " from the QCDB" << std::endl;
+      return nullptr;
+    }
+    std::string plotName = request.path.substr(request.path.rfind('/') + 1);
+    object->SetName(plotName.c_str());
+    auto mo = std::make_shared<MonitorObject>(object, task, "", detector, run, mPeriod, mPass);
+    mo->setIsOwner(true);
+    mo->setValidity({ request.validFrom, request.validUntil });
+
+    // the object is written into a temporary file first, such that an interrupted processing does not leave
+    // incomplete objects in the cache
+    gSystem->mkdir(gSystem->GetDirName(cacheFileName.c_str()).Data(), kTRUE);
+    std::string temporaryFileName = cacheFileName + ".tmp";
+    bool written = false;
+    {
+      TFile cacheFile(temporaryFileName.c_str(), "RECREATE");
+      if (!cacheFile.IsZombie()) {
+        written = cacheFile.WriteTObject(mo.get(), "mo") > 0;
+        cacheFile.Close();
+      }
+    }
+    if (written) {
+      gSystem->Rename(temporaryFileName.c_str(), cacheFileName.c_str());
+    } else {
+      std::cout << "Cannot write the cached object \"" << cacheFileName << "\"" << std::endl;
+      gSystem->Unlink(temporaryFileName.c_str());
+    }
+    return mo;
+  }
+
+  std::string mUrl;
+  std::string mPrefix;
+  std::string mPathPattern;
+  std::string mPeriod;
+  std::string mPass;
+  std::string mCacheDirectory;
+  std::vector<std::unique_ptr<o2::quality_control::repository::CcdbDatabase>> mConnections;
+};
+
+#endif // AQC_QCDBINPUT_H_
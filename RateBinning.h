@@ -0,0 +1,243 @@
+#ifndef AQC_RATEBINNING_H_
+#define AQC_RATEBINNING_H_
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+// Binning of the interaction rate values into intervals.
+//
+// The intervals are stored in decreasing rate order, the interval with index 0 being the
+// one with the highest rates, and each interval includes its lower edge and excludes the upper one.
+// Geometric and linear binnings are looked up in constant time, explicit and adaptive ones
+// via a binary search over the interval edges.
+// Invalid parameters are rejected with an error message, the current binning being kept unchanged.
+class RateBinning
+{
+ public:
+  enum class Mode { Geometric, Linear, Explicit, Adaptive };
+
+  RateBinning() = default;
+
+  // intervals [(1 - step) * r, r] starting from rateMax and going down until rateMin is crossed,
+  // with 0 < rateMin < rateMax and 0 < step < 1. Returns false if the parameters are invalid
+  bool setGeometric(double rateMin, double rateMax, double step)
+  {
+    if (!checkRange("geometric", rateMin, rateMax)) {
+      return false;
+    }
+    if (rateMin <= 0) {
+      std::cout << "Invalid geometric rate binning: the minimum rate must be positive, got " << rateMin
+                << ", keeping the current binning" << std::endl;
+      return false;
+    }
+    if (!(step > 0 && step < 1)) {
+      std::cout << "Invalid geometric rate binning: the step must be between 0 and 1 (excluded), got " << step
+                << ", keeping the current binning" << std::endl;
+      return false;
+    }
+    mMode = Mode::Geometric;
+    mRateMin = rateMin;
+    mRateMax = rateMax;
+    mStep = step;
+    mEdges.clear();
+    double rate = rateMax;
+    mEdges.push_back(rate);
+    while (rate > rateMin) {
+      rate = (1.0 - step) * rate;
+      mEdges.push_back(rate);
+    }
+    mLogStep = -std::log(1.0 - step);
+    return true;
+  }
+
+  // intervals of constant width starting from rateMax and going down until rateMin is crossed,
+  // with rateMin < rateMax and width > 0. Returns false if the parameters are invalid
+  bool setLinear(double rateMin, double rateMax, double width)
+  {
+    if (!checkRange("linear", rateMin, rateMax)) {
+      return false;
+    }
+    if (!(width > 0)) {
+      std::cout << "Invalid linear rate binning: the width must be positive, got " << width
+                << ", keeping the current binning" << std::endl;
+      return false;
+    }
+    mMode = Mode::Linear;
+    mRateMin = rateMin;
+    mRateMax = rateMax;
+    mStep = width;
+    mEdges.clear();
+    int nIntervals = static_cast<int>(std::ceil((rateMax - rateMin) / width));
+    for (int i = 0; i <= nIntervals; i++) {
+      mEdges.push_back(rateMax - width * i);
+    }
+    return true;
+  }
+
+  // intervals defined by an arbitrary list of edges, given in any order
+  void setExplicit(std::vector<double> edges)
+  {
+    mMode = Mode::Explicit;
+    setEdges(std::move(edges));
+  }
+
+  // intervals with balanced numbers of entries, the edges being computed from the quantiles
+  // of the rate values passed to fitAdaptiveEdges()
+  bool setAdaptive(double rateMin, double rateMax, int nIntervals)
+  {
+    if (!checkRange("adaptive", rateMin, rateMax)) {
+      return false;
+    }
+    mMode = Mode::Adaptive;
+    mRateMin = rateMin;
+    mRateMax = rateMax;
+    mNIntervals = nIntervals;
+    mEdges.clear();
+    return true;
+  }
+
+  // configure the binning from a JSON object like
+  //   { "type": "geometric", "min": 1, "max": 50, "step": 0.1 }
+  //   { "type": "linear", "min": 0, "max": 50, "width": 5 }
+  //   { "type": "explicit", "edges": [ 1, 5, 10, 20, 50 ] }
+  //   { "type": "adaptive", "min": 1, "max": 50, "nIntervals": 20 }
+  // missing parameters are taken from the current settings, and invalid ones are rejected
+  void configure(const nlohmann::json& config)
+  {
+    auto type = config.value("type", std::string("geometric"));
+    double rateMin = config.value("min", mRateMin);
+    double rateMax = config.value("max", mRateMax);
+    if (type == "geometric") {
+      setGeometric(rateMin, rateMax, config.value("step", mStep));
+    } else if (type == "linear") {
+      setLinear(rateMin, rateMax, config.at("width").get<double>());
+    } else if (type == "explicit") {
+      setExplicit(config.at("edges").get<std::vector<double>>());
+    } else if (type == "adaptive") {
+      setAdaptive(rateMin, rateMax, config.value("nIntervals", 20));
+    } else {
+      std::cout << "Unknown rate binning type \"" << type << "\", keeping the current binning" << std::endl;
+    }
+  }
+
+  // true if the edges still need to be computed from the observed rate values
+  bool needsRates() const { return (mMode == Mode::Adaptive && mEdges.empty()); }
+
+  // compute the edges of an adaptive binning from the quantiles of the observed rates,
+  // such that each interval contains approximately the same number of values
+  void fitAdaptiveEdges(std::vector<double> rates)
+  {
+    rates.erase(std::remove_if(rates.begin(), rates.end(),
+                               [this](double r) { return (r < mRateMin || r >= mRateMax); }),
+                rates.end());
+    if (rates.empty() || mNIntervals < 1) {
+      setEdges({ mRateMin, mRateMax });
+      return;
+    }
+    std::sort(rates.begin(), rates.end());
+
+    std::vector<double> edges{ mRateMin };
+    for (int i = 1; i < mNIntervals; i++) {
+      size_t position = (rates.size() * i) / mNIntervals;
+      // place the edge half-way between two consecutive values, so that both fall in well defined intervals
+      double edge = (position > 0) ? (rates[position - 1] + rates[position]) / 2 : rates[position];
+      if (edge > edges.back()) {
+        edges.push_back(edge);
+      }
+    }
+    if (mRateMax > edges.back()) {
+      edges.push_back(mRateMax);
+    }
+    setEdges(std::move(edges));
+  }
+
+  // index of the interval containing the given rate, or -1 if the rate is outside of the binning
+  int getIndex(double rate) const
+  {
+    int nIntervals = size();
+    if (nIntervals < 1 || rate >= mEdges.front() || rate < mEdges.back()) {
+      return -1;
+    }
+
+    int index = 0;
+    if (mMode == Mode::Geometric) {
+      index = static_cast<int>(std::log(mEdges.front() / rate) / mLogStep);
+    } else if (mMode == Mode::Linear) {
+      index = static_cast<int>((mEdges.front() - rate) / mStep);
+    } else {
+      // first edge that is lower or equal to the rate, which is the lower edge of the interval
+      auto lowerEdge = std::lower_bound(mEdges.begin(), mEdges.end(), rate, std::greater<double>());
+      return static_cast<int>(std::distance(mEdges.begin(), lowerEdge)) - 1;
+    }
+
+    // correct for rounding errors in the closed-form estimate
+    index = std::clamp(index, 0, nIntervals - 1);
+    while (index > 0 && rate >= mEdges[index]) {
+      index -= 1;
+    }
+    while (index < (nIntervals - 1) && rate < mEdges[index + 1]) {
+      index += 1;
+    }
+    return index;
+  }
+
+  // number of intervals
+  int size() const { return (mEdges.size() < 2) ? 0 : static_cast<int>(mEdges.size() - 1); }
+
+  // lower and upper limits of the interval with the given index
+  std::pair<double, double> getInterval(int index) const { return std::make_pair(mEdges[index + 1], mEdges[index]); }
+
+  Mode getMode() const { return mMode; }
+
+  // interval edges, in decreasing order
+  const std::vector<double>& getEdges() const { return mEdges; }
+
+  void print() const
+  {
+    std::cout << "Rate intervals:";
+    for (int index = 0; index < size(); index++) {
+      auto interval = getInterval(index);
+      std::cout << " [" << interval.first << ", " << interval.second << "]";
+    }
+    std::cout << std::endl;
+  }
+
+ private:
+  bool checkRange(const char* type, double rateMin, double rateMax) const
+  {
+    if (!(rateMin < rateMax)) {
+      std::cout << "Invalid " << type << " rate binning: the minimum rate " << rateMin << " must be lower than the maximum rate "
+                << rateMax << ", keeping the current binning" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  void setEdges(std::vector<double> edges)
+  {
+    std::sort(edges.begin(), edges.end(), std::greater<double>());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    mEdges = std::move(edges);
+    if (!mEdges.empty()) {
+      mRateMax = mEdges.front();
+      mRateMin = mEdges.back();
+    }
+  }
+
+  Mode mMode{ Mode::Geometric };
+  double mRateMin{ 1 };
+  double mRateMax{ 50 };
+  double mStep{ 0.1 };
+  double mLogStep{ 0 };
+  int mNIntervals{ 20 };
+  std::vector<double> mEdges;
+};
+
+#endif // AQC_RATEBINNING_H_
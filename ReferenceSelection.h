@@ -0,0 +1,113 @@
+#ifndef AQC_REFERENCESELECTION_H_
+#define AQC_REFERENCESELECTION_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <vector>
+
+// Automatic selection of the reference runs of a production.
+//
+// The selection uses the per-window summaries of a processing without reference runs, in which each time window
+// is compared with the consensus of its rate interval (the average of all the windows in the interval). A run
+// can be the reference of a rate interval if it has enough windows in the interval, and if few of them were
+// flagged as bad or medium. The reference runs are valid up to a maximum rate, and therefore cover contiguous
+// ranges of rate intervals: the intervals are scanned in increasing rate order, and at each step the run whose
+// coverage extends the furthest is selected, which gives the minimal number of reference runs. Among the runs
+// with the same coverage, the most compatible with the consensus (lowest average fraction of bad bins) are
+// preferred, and then the one with the highest statistics.
+
+// checked windows of one run in one rate interval, accumulated over all the plots
+struct ReferenceCandidate
+{
+  int nWindows{ 0 };   // number of distinct time windows
+  int nChecks{ 0 };    // number of checked plots in all the time windows
+  int nNotGood{ 0 };   // checks with bad or medium quality
+  double sumFracBad{ 0 };
+  double entries{ 0 }; // total number of entries of the checked plots
+};
+
+struct ReferenceSelectionParameters
+{
+  int minWindows{ 3 };                  // minimum number of time windows in a rate interval
+  double maxFracNotGood{ 0.1 };         // maximum fraction of bad or medium checks in a rate interval
+  double compatibilityTolerance{ 0.01 }; // runs whose average fraction of bad bins differ by less are equally compatible
+};
+
+// reference run covering the rate intervals in [first, last], as positions in increasing rate order
+struct SelectedReference
+{
+  int run{ 0 };
+  size_t first{ 0 };
+  size_t last{ 0 };
+  double meanFracBad{ 0 };
+  double entries{ 0 };
+};
+
+// candidates[i] are the runs of the i-th rate interval, the intervals being given in increasing rate order.
+// The intervals without any acceptable run are not covered by their own reference: they fall in the range of the
+// next reference run, whose windows are used if it has some in the interval, and are otherwise checked against
+// their average
+inline std::vector<SelectedReference> selectReferenceRuns(const std::vector<std::map<int, ReferenceCandidate>>& candidates,
+                                                          const ReferenceSelectionParameters& parameters)
+{
+  auto getCandidate = [&](size_t interval, int run) -> const ReferenceCandidate* {
+    auto candidate = candidates[interval].find(run);
+    if (candidate == candidates[interval].end()) {
+      return nullptr;
+    }
+    const auto& c = candidate->second;
+    bool accepted = (c.nWindows >= parameters.minWindows) && (c.nChecks > 0) &&
+                    (double(c.nNotGood) / c.nChecks <= parameters.maxFracNotGood);
+    return accepted ? &c : nullptr;
+  };
+
+  std::vector<SelectedReference> result;
+  for (size_t first = 0; first < candidates.size();) {
+    // coverage and compatibility of each acceptable run, starting from the first uncovered interval
+    std::vector<SelectedReference> options;
+    for (auto& [run, candidate] : candidates[first]) {
+      if (!getCandidate(first, run)) continue;
+      SelectedReference option{ run, first, first };
+      int nChecks = 0;
+      double sumFracBad = 0;
+      for (size_t interval = first; interval < candidates.size(); interval++) {
+        auto* c = getCandidate(interval, run);
+        if (!c) break;
+        option.last = interval;
+        nChecks += c->nChecks;
+        sumFracBad += c->sumFracBad;
+        option.entries += c->entries;
+      }
+      option.meanFracBad = sumFracBad / nChecks;
+      options.push_back(option);
+    }
+    if (options.empty()) {
+      first += 1;
+      continue;
+    }
+
+    size_t maxLast = 0;
+    double minFracBad = 1;
+    for (auto& option : options) {
+      maxLast = std::max(maxLast, option.last);
+    }
+    for (auto& option : options) {
+      if (option.last == maxLast) {
+        minFracBad = std::min(minFracBad, option.meanFracBad);
+      }
+    }
+    const SelectedReference* best = nullptr;
+    for (auto& option : options) {
+      if (option.last != maxLast || option.meanFracBad > minFracBad + parameters.compatibilityTolerance) continue;
+      if (!best || option.entries > best->entries) {
+        best = &option;
+      }
+    }
+    result.push_back(*best);
+    first = best->last + 1;
+  }
+  return result;
+}
+
+#endif // AQC_REFERENCESELECTION_H_
@@ -0,0 +1,156 @@
+#ifndef AQC_ROBUSTESTIMATORS_H_
+#define AQC_ROBUSTESTIMATORS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Estimators used to build the expected distribution of a rate interval from the histograms it contains.
+//
+// Iterative: average of the histograms, iteratively removing the ones that are not compatible with it
+// Median:      per-bin median of the histograms
+// TrimmedMean: per-bin mean after discarding a given fraction of the lowest and highest values
+// Huber:       per-bin Huber M-estimator of the mean, starting from the median and the MAD
+//
+// The non-iterative estimators process each bin independently, with a cost that only depends
+// on the number of histograms and bins.
+enum class ReferenceEstimator { Iterative, Median, TrimmedMean, Huber };
+
+inline ReferenceEstimator getReferenceEstimator(const std::string& name)
+{
+  if (name.empty() || name == "iterative") {
+    return ReferenceEstimator::Iterative;
+  } else if (name == "median") {
+    return ReferenceEstimator::Median;
+  } else if (name == "trimmedMean") {
+    return ReferenceEstimator::TrimmedMean;
+  } else if (name == "huber") {
+    return ReferenceEstimator::Huber;
+  }
+  std::cout << "Unknown reference estimator \"" << name << "\", using the iterative average" << std::endl;
+  return ReferenceEstimator::Iterative;
+}
+
+namespace robust_estimators
+{
+
+// median of the values in [begin, end), which are partially reordered
+inline double median(double* begin, double* end)
+{
+  size_t n = end - begin;
+  if (n == 0) {
+    return 0;
+  }
+  double* middle = begin + n / 2;
+  std::nth_element(begin, middle, end);
+  double result = *middle;
+  if (n % 2 == 0) {
+    result = (result + *std::max_element(begin, middle)) / 2;
+  }
+  return result;
+}
+
+} // namespace robust_estimators
+
+// Compute the per-bin robust estimate of nSamples distributions with nBins bins each.
+// The input values and errors are stored bin by bin, the values of the bin i being at
+// positions [i * nSamples, (i + 1) * nSamples).
+// The parameter is the trimmed fraction on each side for the trimmed mean, and the
+// cut-off in units of standard deviations for the Huber estimator.
+inline void computeRobustReference(ReferenceEstimator estimator,
+                                   const std::vector<double>& values,
+                                   const std::vector<double>& errors,
+                                   size_t nSamples, size_t nBins, double parameter,
+                                   std::vector<double>& result,
+                                   std::vector<double>& resultErrors)
+{
+  result.assign(nBins, 0);
+  resultErrors.assign(nBins, 0);
+  if (nSamples == 0) {
+    return;
+  }
+
+  std::vector<double> sorted(nSamples);
+  std::vector<double> deviations(nSamples);
+
+  for (size_t bin = 0; bin < nBins; bin++) {
+    const double* binValues = values.data() + bin * nSamples;
+    const double* binErrors = errors.data() + bin * nSamples;
+
+    // error of the plain average, used to derive the error of the robust estimates
+    double sumErrors2 = 0;
+    for (size_t i = 0; i < nSamples; i++) {
+      sumErrors2 += binErrors[i] * binErrors[i];
+    }
+    double meanError = std::sqrt(sumErrors2) / nSamples;
+
+    std::copy(binValues, binValues + nSamples, sorted.begin());
+
+    switch (estimator) {
+      case ReferenceEstimator::Median: {
+        result[bin] = robust_estimators::median(sorted.data(), sorted.data() + nSamples);
+        // asymptotic efficiency of the median for gaussian samples
+        resultErrors[bin] = std::sqrt(M_PI / 2) * meanError;
+        break;
+      }
+      case ReferenceEstimator::TrimmedMean: {
+        size_t nTrimmed = static_cast<size_t>(std::clamp(parameter, 0.0, 0.49) * nSamples);
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0;
+        for (size_t i = nTrimmed; i < nSamples - nTrimmed; i++) {
+          sum += sorted[i];
+        }
+        size_t nKept = nSamples - 2 * nTrimmed;
+        result[bin] = sum / nKept;
+        resultErrors[bin] = std::sqrt(sumErrors2 / nSamples) / std::sqrt(double(nKept));
+        break;
+      }
+      case ReferenceEstimator::Huber: {
+        double center = robust_estimators::median(sorted.data(), sorted.data() + nSamples);
+        for (size_t i = 0; i < nSamples; i++) {
+          deviations[i] = std::fabs(binValues[i] - center);
+        }
+        // the MAD is converted into a standard deviation assuming gaussian samples,
+        // and the statistical error is used as a lower bound for the scale
+        double scale = 1.4826 * robust_estimators::median(deviations.data(), deviations.data() + nSamples);
+        scale = std::max(scale, std::sqrt(sumErrors2 / nSamples));
+
+        // two re-weighting passes are enough to converge for the typical number of samples
+        double sumWeights = 0;
+        double sumWeights2Errors2 = 0;
+        for (int pass = 0; pass < 2; pass++) {
+          double sum = 0;
+          sumWeights = 0;
+          sumWeights2Errors2 = 0;
+          for (size_t i = 0; i < nSamples; i++) {
+            double deviation = std::fabs(binValues[i] - center);
+            double weight = (scale <= 0 || deviation <= parameter * scale) ? 1.0 : (parameter * scale / deviation);
+            sum += weight * binValues[i];
+            sumWeights += weight;
+            sumWeights2Errors2 += weight * weight * binErrors[i] * binErrors[i];
+          }
+          if (sumWeights > 0) {
+            center = sum / sumWeights;
+          }
+        }
+        result[bin] = center;
+        resultErrors[bin] = (sumWeights > 0) ? std::sqrt(sumWeights2Errors2) / sumWeights : meanError;
+        break;
+      }
+      default: {
+        double sum = 0;
+        for (size_t i = 0; i < nSamples; i++) {
+          sum += binValues[i];
+        }
+        result[bin] = sum / nSamples;
+        resultErrors[bin] = meanError;
+        break;
+      }
+    }
+  }
+}
+
+#endif // AQC_ROBUSTESTIMATORS_H_
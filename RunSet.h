@@ -0,0 +1,72 @@
+#ifndef AQC_RUNSET_H_
+#define AQC_RUNSET_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Canonical set of the runs of a production, each run being tagged with its roles.
+//
+// A run can be listed in several places of the runs configuration, for example both as a run to be
+// checked and as a reference run. It nevertheless appears only once in the set, such that its QC files
+// are loaded once and the same MOs are used both by the checks and as reference.
+
+enum class RunRole : unsigned {
+  Test = 1,      // run to be checked, listed in "runs"
+  Reference = 2, // run listed in "referenceRuns"
+  Production = 4 // run of the production, listed in "productionRuns" and included in the reports
+};
+
+class RunSet
+{
+ public:
+  void add(int run, RunRole role) { mRoles[run] |= static_cast<unsigned>(role); }
+
+  bool hasRole(int run, RunRole role) const
+  {
+    auto roles = mRoles.find(run);
+    return (roles != mRoles.end()) && ((roles->second & static_cast<unsigned>(role)) != 0);
+  }
+
+  // runs with the given role, in increasing order
+  std::vector<int> getRuns(RunRole role) const
+  {
+    std::vector<int> runs;
+    for (auto& [run, roles] : mRoles) {
+      if ((roles & static_cast<unsigned>(role)) != 0) {
+        runs.push_back(run);
+      }
+    }
+    return runs;
+  }
+
+  // runs whose QC files must be loaded, that is the test and reference runs, in increasing order
+  std::vector<int> getInputRuns() const
+  {
+    std::vector<int> runs;
+    for (auto& [run, roles] : mRoles) {
+      if ((roles & (static_cast<unsigned>(RunRole::Test) | static_cast<unsigned>(RunRole::Reference))) != 0) {
+        runs.push_back(run);
+      }
+    }
+    return runs;
+  }
+
+  // comma-separated list of the roles of a run, for printing
+  std::string getRoleNames(int run) const
+  {
+    std::string names;
+    for (auto [role, name] : { std::make_pair(RunRole::Test, "test"), std::make_pair(RunRole::Reference, "reference"),
+                               std::make_pair(RunRole::Production, "production") }) {
+      if (hasRole(run, role)) {
+        names += (names.empty() ? "" : ", ") + std::string(name);
+      }
+    }
+    return names;
+  }
+
+ private:
+  std::map<int, unsigned> mRoles;
+};
+
+#endif // AQC_RUNSET_H_
@@ -0,0 +1,135 @@
+#ifndef AQC_THRESHOLDSCAN_H_
+#define AQC_THRESHOLDSCAN_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "./BinCheck.h"
+#include "./HistogramBuffers.h"
+
+// Scan of the parameters of the bin-by-bin checks over a grid of values.
+//
+// For each combination of rebinning and check range, the ratios of all the time windows of a rate interval are
+// computed once, and the deviations from unity and the errors of their checked bins are kept in flat arrays.
+// The bad bins are then counted for all the (threshold, nSigma) pairs in a single pass over these arrays, with
+// a branch-less inner loop over contiguous bins, and each window is classified for all the (maxFracBad,
+// maxFracMedium) pairs from its fractions of bad bins. The result is the number of bad and medium windows for
+// each point of the grid, such that the thresholds of a plot can be tuned with a single processing.
+
+// values of the scanned parameters, the parameters that are not scanned having a single value
+struct ThresholdScanGrid
+{
+  std::vector<int> rebins;
+  std::vector<std::pair<double, double>> checkRanges;
+  std::vector<double> thresholds;
+  std::vector<double> nSigmas;
+  std::vector<double> maxFracBad;
+  std::vector<double> maxFracMedium;
+
+  bool empty() const { return size() == 0; }
+
+  // the settings are ordered by rebinning, check range, threshold, nSigma, maxFracBad and maxFracMedium,
+  // the last parameter varying fastest
+  size_t getNbinnings() const { return rebins.size() * checkRanges.size(); }
+  size_t getNcheckSettings() const { return thresholds.size() * nSigmas.size(); }
+  size_t getNqualitySettings() const { return maxFracBad.size() * maxFracMedium.size(); }
+  size_t size() const { return getNbinnings() * getNcheckSettings() * getNqualitySettings(); }
+};
+
+// numbers of windows of one point of the grid
+struct ThresholdScanCounts
+{
+  int nWindows{ 0 };
+  int nBad{ 0 };
+  int nMedium{ 0 };
+
+  ThresholdScanCounts& operator+=(const ThresholdScanCounts& other)
+  {
+    nWindows += other.nWindows;
+    nBad += other.nBad;
+    nMedium += other.nMedium;
+    return *this;
+  }
+};
+
+// deviations from unity and errors of the checked bins of the ratios of several windows, stored window by window
+struct ScanRatioArrays
+{
+  std::vector<double> deviations;
+  std::vector<double> errors;
+  std::vector<size_t> offsets{ 0 }; // [offsets[i], offsets[i + 1]) are the bins of the i-th window
+
+  void clear()
+  {
+    deviations.clear();
+    errors.clear();
+    offsets.assign(1, 0);
+  }
+
+  size_t getNwindows() const { return offsets.size() - 1; }
+
+  // append the checked bins or cells of the ratio of one window
+  void add(const BinnedValues& ratio, const WindowBinning& binning)
+  {
+    auto addBin = [&](int bin) {
+      deviations.push_back(std::fabs(ratio.content[bin] - 1.0));
+      errors.push_back(ratio.error[bin]);
+    };
+    if (binning.is2D) {
+      for (int cell : binning.checkCells) {
+        addBin(cell);
+      }
+    } else {
+      int last = std::min(binning.checkRange.last, ratio.getNbins());
+      for (int bin = binning.checkRange.first; bin <= last; bin++) {
+        addBin(bin);
+      }
+    }
+    offsets.push_back(deviations.size());
+  }
+};
+
+// Classify the windows stored in the arrays for all the check and quality settings of the grid, and add the
+// results to the counts of the given binning. counts must have grid.size() elements
+inline void addThresholdScanCounts(const ScanRatioArrays& arrays, const ThresholdScanGrid& grid, size_t binningIndex,
+                                   std::vector<ThresholdScanCounts>& counts)
+{
+  size_t nQualitySettings = grid.getNqualitySettings();
+  size_t firstCount = binningIndex * grid.getNcheckSettings() * nQualitySettings;
+  for (size_t window = 0; window < arrays.getNwindows(); window++) {
+    const double* deviations = arrays.deviations.data() + arrays.offsets[window];
+    const double* errors = arrays.errors.data() + arrays.offsets[window];
+    size_t nBins = arrays.offsets[window + 1] - arrays.offsets[window];
+
+    size_t checkSetting = 0;
+    for (double threshold : grid.thresholds) {
+      for (double nSigma : grid.nSigmas) {
+        // same condition as checkRatioBins(), counted without branches
+        int nBad = 0;
+        for (size_t bin = 0; bin < nBins; bin++) {
+          nBad += (deviations[bin] > threshold + errors[bin] * nSigma) ? 1 : 0;
+        }
+        double fracBad = (nBins > 0) ? (double(nBad) / nBins) : 0;
+
+        auto* settingCounts = counts.data() + firstCount + checkSetting * nQualitySettings;
+        for (double maxFracBad : grid.maxFracBad) {
+          for (double maxFracMedium : grid.maxFracMedium) {
+            settingCounts->nWindows += 1;
+            if (fracBad > maxFracBad) {
+              settingCounts->nBad += 1;
+            } else if (fracBad > maxFracMedium) {
+              settingCounts->nMedium += 1;
+            }
+            settingCounts++;
+          }
+        }
+        checkSetting += 1;
+      }
+    }
+  }
+}
+
+#endif // AQC_THRESHOLDSCAN_H_
@@ -0,0 +1,87 @@
+#ifndef AQC_TIMEINTERVALINDEX_H_
+#define AQC_TIMEINTERVALINDEX_H_
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Index of the time intervals flagged by the checks of the plots of one run.
+//
+// The intervals of each plot, and their union across all the plots, are stored as sorted sets of
+// disjoint intervals, merged at insertion time: an interval overlapping or touching existing ones
+// is merged with them, such that each insertion only costs O(log n) plus the number of merged intervals.
+// The interval limits are inclusive.
+
+class TimeIntervalIndex
+{
+ public:
+  using Interval = std::pair<long, long>;
+
+  void insert(const std::string& plotName, long min, long max)
+  {
+    insertAndMerge(mPlotIntervals[plotName], min, max);
+    insertAndMerge(mUnion, min, max);
+  }
+
+  bool empty() const { return mUnion.empty(); }
+
+  // merged intervals of each plot, as a map from the lower to the upper limits
+  const std::map<std::string, std::map<long, long>>& getPlotIntervals() const { return mPlotIntervals; }
+
+  // union of the intervals of all the plots, in ascending order
+  std::vector<Interval> getUnion() const { return std::vector<Interval>(mUnion.begin(), mUnion.end()); }
+
+  // names of the plots with a flagged interval containing the given time
+  std::vector<std::string> getPlotsAt(long time) const { return getPlotsOverlapping(time, time); }
+
+  // names of the plots with a flagged interval overlapping [min, max]
+  std::vector<std::string> getPlotsOverlapping(long min, long max) const
+  {
+    std::vector<std::string> plots;
+    for (auto& [plotName, intervals] : mPlotIntervals) {
+      if (overlaps(intervals, min, max)) {
+        plots.push_back(plotName);
+      }
+    }
+    return plots;
+  }
+
+  // whether the union of the intervals overlaps [min, max]
+  bool overlaps(long min, long max) const { return overlaps(mUnion, min, max); }
+
+ private:
+  static bool overlaps(const std::map<long, long>& intervals, long min, long max)
+  {
+    // the last interval starting before or at max is the only candidate, as the intervals are disjoint
+    auto it = intervals.upper_bound(max);
+    if (it == intervals.begin()) {
+      return false;
+    }
+    return std::prev(it)->second >= min;
+  }
+
+  static void insertAndMerge(std::map<long, long>& intervals, long min, long max)
+  {
+    // start from the interval preceding the new one, if it reaches the new lower limit
+    auto it = intervals.upper_bound(min);
+    if (it != intervals.begin() && std::prev(it)->second >= min) {
+      it = std::prev(it);
+    }
+
+    // absorb all the intervals overlapping with the new one
+    while (it != intervals.end() && it->first <= max) {
+      min = std::min(min, it->first);
+      max = std::max(max, it->second);
+      it = intervals.erase(it);
+    }
+    intervals.emplace_hint(it, min, max);
+  }
+
+  std::map<std::string, std::map<long, long>> mPlotIntervals;
+  std::map<long, long> mUnion;
+};
+
+#endif // AQC_TIMEINTERVALINDEX_H_
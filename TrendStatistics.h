@@ -0,0 +1,279 @@
+#ifndef AQC_TRENDSTATISTICS_H_
+#define AQC_TRENDSTATISTICS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <TDirectory.h>
+#include <TTree.h>
+
+#include "./BinCheck.h"
+#include "./HistogramBuffers.h"
+
+// Statistics of the histograms used in the trends, and columnar table storing them.
+//
+// All the statistics requested for a histogram are computed in a single sweep over its bins:
+// the sums needed by the moments, the integral and the fractions in range are accumulated together
+// with the cumulative distribution, from which the quantiles are then interpolated.
+// The moments are computed from the bin contents, using the bin centers.
+
+enum class TrendStatisticType {
+  Mean,
+  Rms,
+  Integral,
+  Entries,
+  Quantile,
+  FracInRange
+};
+
+struct TrendStatistic
+{
+  TrendStatisticType type;
+  double min{ 0 }; // probability of the quantiles, lower limit of the fractions in range
+  double max{ 0 }; // upper limit of the fractions in range
+  std::string name; // name of the column in the trend table
+};
+
+namespace trend_statistics
+{
+
+// number formatted such that it can be used in branch names, for example -2.5 -> m2p5
+inline std::string getNameForValue(double value)
+{
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%g", value);
+  std::string result;
+  for (const char* c = buffer; *c; c++) {
+    result += (*c == '-') ? std::string("m") : ((*c == '.') ? std::string("p") : std::string(1, *c));
+  }
+  return result;
+}
+
+} // namespace trend_statistics
+
+// Parse a statistic from its specification in the trends configuration:
+// "mean", "rms", "integral", "entries", "median", "quantile:<probability>" or "fracInRange:<min>:<max>"
+inline std::optional<TrendStatistic> parseTrendStatistic(const std::string& spec)
+{
+  std::vector<std::string> fields;
+  size_t start = 0;
+  while (true) {
+    size_t end = spec.find(':', start);
+    fields.push_back(spec.substr(start, end - start));
+    if (end == std::string::npos) {
+      break;
+    }
+    start = end + 1;
+  }
+
+  try {
+    if (fields[0] == "mean" && fields.size() == 1) {
+      return TrendStatistic{ TrendStatisticType::Mean, 0, 0, "mean" };
+    }
+    if (fields[0] == "rms" && fields.size() == 1) {
+      return TrendStatistic{ TrendStatisticType::Rms, 0, 0, "rms" };
+    }
+    if (fields[0] == "integral" && fields.size() == 1) {
+      return TrendStatistic{ TrendStatisticType::Integral, 0, 0, "integral" };
+    }
+    if (fields[0] == "entries" && fields.size() == 1) {
+      return TrendStatistic{ TrendStatisticType::Entries, 0, 0, "entries" };
+    }
+    if (fields[0] == "median" && fields.size() == 1) {
+      return TrendStatistic{ TrendStatisticType::Quantile, 0.5, 0, "median" };
+    }
+    if (fields[0] == "quantile" && fields.size() == 2) {
+      double probability = std::stod(fields[1]);
+      if (probability < 0 || probability > 1) {
+        return std::nullopt;
+      }
+      return TrendStatistic{ TrendStatisticType::Quantile, probability, 0,
+                             std::string("quantile_") + trend_statistics::getNameForValue(probability) };
+    }
+    if (fields[0] == "fracInRange" && fields.size() == 3) {
+      double min = std::stod(fields[1]);
+      double max = std::stod(fields[2]);
+      return TrendStatistic{ TrendStatisticType::FracInRange, min, max,
+                             std::string("fracInRange_") + trend_statistics::getNameForValue(min) + "_" + trend_statistics::getNameForValue(max) };
+    }
+  } catch (const std::exception&) {
+  }
+  return std::nullopt;
+}
+
+// Compute the requested statistics of the given bin values, excluding the underflow and overflow bins.
+// The number of entries is taken from the original histogram, and cumulative is a scratch buffer
+inline void computeTrendStatistics(const BinnedValues& values, const AxisBinning& axis, double entries,
+                                   const std::vector<TrendStatistic>& statistics, std::vector<double>& results,
+                                   std::vector<double>& cumulative)
+{
+  int nBins = values.getNbins();
+
+  std::vector<BinRange> ranges(statistics.size());
+  std::vector<double> sumsInRange(statistics.size(), 0);
+  for (size_t i = 0; i < statistics.size(); i++) {
+    if (statistics[i].type == TrendStatisticType::FracInRange) {
+      ranges[i] = getCheckBinRange(&axis, statistics[i].min, statistics[i].max);
+    }
+  }
+
+  // single sweep over the bins
+  double sumw = 0;
+  double sumwx = 0;
+  double sumwx2 = 0;
+  cumulative.resize(nBins + 1);
+  cumulative[0] = 0;
+  for (int bin = 1; bin <= nBins; bin++) {
+    double w = values.content[bin];
+    double x = axis.GetBinCenter(bin);
+    sumw += w;
+    sumwx += w * x;
+    sumwx2 += w * x * x;
+    cumulative[bin] = sumw;
+    for (size_t i = 0; i < statistics.size(); i++) {
+      if (statistics[i].type == TrendStatisticType::FracInRange && bin >= ranges[i].first && bin <= ranges[i].last) {
+        sumsInRange[i] += w;
+      }
+    }
+  }
+
+  double mean = (sumw != 0) ? (sumwx / sumw) : 0;
+  double rms = (sumw != 0) ? std::sqrt(std::fabs(sumwx2 / sumw - mean * mean)) : 0;
+
+  results.resize(statistics.size());
+  for (size_t i = 0; i < statistics.size(); i++) {
+    auto& statistic = statistics[i];
+    switch (statistic.type) {
+      case TrendStatisticType::Mean:
+        results[i] = mean;
+        break;
+      case TrendStatisticType::Rms:
+        results[i] = rms;
+        break;
+      case TrendStatisticType::Integral:
+        results[i] = sumw;
+        break;
+      case TrendStatisticType::Entries:
+        results[i] = entries;
+        break;
+      case TrendStatisticType::FracInRange:
+        results[i] = (sumw != 0) ? (sumsInRange[i] / sumw) : 0;
+        break;
+      case TrendStatisticType::Quantile: {
+        // linear interpolation within the bin where the cumulative distribution crosses the probability
+        results[i] = 0;
+        if (sumw <= 0 || nBins < 1) {
+          break;
+        }
+        double target = statistic.min * sumw;
+        int bin = static_cast<int>(std::distance(cumulative.begin(), std::lower_bound(cumulative.begin() + 1, cumulative.end(), target)));
+        bin = std::min(std::max(bin, 1), nBins);
+        double low = axis.GetBinLowEdge(bin);
+        double width = axis.GetBinLowEdge(bin + 1) - low;
+        double content = cumulative[bin] - cumulative[bin - 1];
+        results[i] = (content > 0) ? (low + width * (target - cumulative[bin - 1]) / content) : low;
+        break;
+      }
+    }
+  }
+}
+
+// Columnar table with the statistics of one plot, with one row for each time window
+struct TrendTable
+{
+  std::vector<std::string> statisticNames;
+  std::vector<int> runs;
+  std::vector<long> validityMin;
+  std::vector<long> validityMax;
+  std::vector<double> rates;
+  std::vector<std::vector<double>> columns; // one column for each statistic
+
+  size_t size() const { return runs.size(); }
+
+  void addRow(int run, long min, long max, double rate, const std::vector<double>& values)
+  {
+    runs.push_back(run);
+    validityMin.push_back(min);
+    validityMax.push_back(max);
+    rates.push_back(rate);
+    columns.resize(statisticNames.size());
+    for (size_t i = 0; i < columns.size(); i++) {
+      columns[i].push_back(values[i]);
+    }
+  }
+};
+
+// write the table as a TTree in the given directory, with one branch for each column
+inline void writeTrendTable(const TrendTable& table, TDirectory* directory, const char* name, const char* title)
+{
+  TDirectory::TContext context(directory);
+  TTree tree(name, title);
+
+  int run;
+  Long64_t min;
+  Long64_t max;
+  double rate;
+  std::vector<double> values(table.statisticNames.size());
+  tree.Branch("run", &run, "run/I");
+  tree.Branch("validityMin", &min, "validityMin/L");
+  tree.Branch("validityMax", &max, "validityMax/L");
+  tree.Branch("rate", &rate, "rate/D");
+  for (size_t i = 0; i < values.size(); i++) {
+    tree.Branch(table.statisticNames[i].c_str(), &values[i], (table.statisticNames[i] + "/D").c_str());
+  }
+
+  for (size_t row = 0; row < table.size(); row++) {
+    run = table.runs[row];
+    min = table.validityMin[row];
+    max = table.validityMax[row];
+    rate = table.rates[row];
+    for (size_t i = 0; i < values.size(); i++) {
+      values[i] = table.columns[i][row];
+    }
+    tree.Fill();
+  }
+  tree.Write();
+}
+
+// read a table written by writeTrendTable(), returning an empty table if the tree is not found
+inline TrendTable readTrendTable(TDirectory* directory, const char* name)
+{
+  TrendTable table;
+  auto* tree = directory->Get<TTree>(name);
+  if (!tree) {
+    return table;
+  }
+
+  int run;
+  Long64_t min;
+  Long64_t max;
+  double rate;
+  for (auto* branch : *tree->GetListOfBranches()) {
+    std::string branchName = branch->GetName();
+    if (branchName != "run" && branchName != "validityMin" && branchName != "validityMax" && branchName != "rate") {
+      table.statisticNames.push_back(branchName);
+    }
+  }
+  std::vector<double> values(table.statisticNames.size());
+  tree->SetBranchAddress("run", &run);
+  tree->SetBranchAddress("validityMin", &min);
+  tree->SetBranchAddress("validityMax", &max);
+  tree->SetBranchAddress("rate", &rate);
+  for (size_t i = 0; i < values.size(); i++) {
+    tree->SetBranchAddress(table.statisticNames[i].c_str(), &values[i]);
+  }
+
+  for (Long64_t entry = 0; entry < tree->GetEntries(); entry++) {
+    tree->GetEntry(entry);
+    table.addRow(run, min, max, rate, values);
+  }
+  delete tree;
+  return table;
+}
+
+#endif // AQC_TRENDSTATISTICS_H_
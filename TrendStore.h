@@ -0,0 +1,72 @@
+#ifndef AQC_TRENDSTORE_H_
+#define AQC_TRENDSTORE_H_
+
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <TSystem.h>
+
+#include "nlohmann/json.hpp"
+
+// Long-term store of the per-window summaries of the processed productions.
+//
+// Each production is stored in a separate ROOT file, STORE/YEAR/PERIOD/PASS/ID.root, containing one
+// trend table (see TrendStatistics.h) for each checked plot, with one row for each time window.
+// The file is rewritten each time the production is processed.
+// The productions are listed in STORE/index.json, together with their runs, time range and plots,
+// such that the productions to be queried can be selected without opening the ROOT files.
+
+// names of the columns of the tables in the store, in addition to run, validity and rate
+const std::vector<std::string> kTrendStoreColumns{ "rateInterval", "fracBad", "quality", "mean", "rms", "integral", "entries" };
+
+// path of the file of a production, relative to the store
+inline std::string getTrendStoreFileName(const std::string& year, const std::string& period, const std::string& pass, const std::string& id)
+{
+  return year + "/" + period + "/" + pass + "/" + id + ".root";
+}
+
+inline nlohmann::json readTrendStoreIndex(const std::string& storePath)
+{
+  std::ifstream indexFile(storePath + "/index.json");
+  if (!indexFile) {
+    return nlohmann::json::array();
+  }
+  try {
+    return nlohmann::json::parse(indexFile);
+  } catch (const nlohmann::json::exception& e) {
+    std::cout << "Invalid store index \"" << storePath << "/index.json\": " << e.what() << std::endl;
+    return nlohmann::json::array();
+  }
+}
+
+// add the given production to the index, replacing the previous entry of the same production if any.
+// The index is written to a temporary file first, such that an interrupted update does not corrupt it
+inline void updateTrendStoreIndex(const std::string& storePath, nlohmann::json entry)
+{
+  auto index = readTrendStoreIndex(storePath);
+
+  nlohmann::json updatedIndex = nlohmann::json::array();
+  for (auto& production : index) {
+    if (production.value("year", "") == entry.value("year", "") && production.value("period", "") == entry.value("period", "") &&
+        production.value("pass", "") == entry.value("pass", "") && production.value("id", "") == entry.value("id", "")) {
+      continue;
+    }
+    updatedIndex.push_back(production);
+  }
+  entry["updated"] = static_cast<long>(std::time(nullptr));
+  updatedIndex.push_back(entry);
+
+  std::string indexFileName = storePath + "/index.json";
+  std::string temporaryFileName = indexFileName + ".tmp" + std::to_string(gSystem->GetPid());
+  {
+    std::ofstream indexFile(temporaryFileName);
+    indexFile << updatedIndex.dump(2) << std::endl;
+  }
+  std::rename(temporaryFileName.c_str(), indexFileName.c_str());
+}
+
+#endif // AQC_TRENDSTORE_H_
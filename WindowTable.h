@@ -0,0 +1,115 @@
+#ifndef AQC_WINDOWTABLE_H_
+#define AQC_WINDOWTABLE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <TH1.h>
+#include <QualityControl/MonitorObject.h>
+
+// Time window of a plot, with the properties used by the checks, the reports and the drawing of the pages,
+// which are extracted once when the MO is loaded
+struct WindowDescriptor
+{
+  int run{ 0 };
+  uint64_t validityMin{ 0 };
+  uint64_t validityMax{ 0 };
+  double rate{ 0 };
+  int rateInterval{ -1 }; // index of the rate interval, -1 if the rate is outside of the intervals
+  std::string timeLabel;  // run number and time range, as shown in the legends
+  TH1* hist{ nullptr };   // histogram of the time window, owned by the MO
+  std::shared_ptr<o2::quality_control::core::MonitorObject> mo;
+};
+
+// Flat table of the time windows of a plot.
+//
+// The windows are appended while the MOs are loaded, and are then sorted by rate interval, run and rate
+// once the rate intervals are assigned, such that the windows of each rate interval are contiguous, or only by
+// run and rate for the trends, which do not use the rate intervals.
+// The table is not modified afterwards, and the pointers to its windows remain valid while it exists.
+class WindowTable
+{
+ public:
+  // window of the given run with the given validity, or nullptr if not loaded yet
+  WindowDescriptor* find(int run, uint64_t validityMin, uint64_t validityMax)
+  {
+    auto window = mWindowIndexes.find({ run, validityMin, validityMax });
+    return (window != mWindowIndexes.end()) ? &mWindows[window->second] : nullptr;
+  }
+
+  void add(WindowDescriptor window)
+  {
+    mWindowIndexes[{ window.run, window.validityMin, window.validityMax }] = mWindows.size();
+    mWindows.push_back(std::move(window));
+  }
+
+  // assign the rate interval of each window with getIndex(rate), and sort the windows
+  template <class Function>
+  void assignRateIntervals(Function getIndex)
+  {
+    for (auto& window : mWindows) {
+      window.rateInterval = getIndex(window.rate);
+    }
+    std::stable_sort(mWindows.begin(), mWindows.end(), [](const WindowDescriptor& w1, const WindowDescriptor& w2) {
+      return std::tie(w1.rateInterval, w1.run, w1.rate) < std::tie(w2.rateInterval, w2.run, w2.rate);
+    });
+    mWindowIndexes.clear();
+    mIntervalRanges.clear();
+    for (size_t position = 0; position < mWindows.size(); position++) {
+      auto& range = mIntervalRanges.try_emplace(mWindows[position].rateInterval, position, position).first->second;
+      range.second = position + 1;
+    }
+  }
+
+  // sort the windows by run and rate, without assigning the rate intervals
+  void sortByRunAndRate()
+  {
+    std::stable_sort(mWindows.begin(), mWindows.end(), [](const WindowDescriptor& w1, const WindowDescriptor& w2) {
+      return std::tie(w1.run, w1.rate) < std::tie(w2.run, w2.rate);
+    });
+    mWindowIndexes.clear();
+    mIntervalRanges.clear();
+  }
+
+  const std::vector<WindowDescriptor>& getWindows() const { return mWindows; }
+  bool empty() const { return mWindows.empty(); }
+  size_t size() const { return mWindows.size(); }
+
+  // windows of a given rate interval, empty if the rate intervals are not assigned
+  std::span<const WindowDescriptor> getRateInterval(int index) const
+  {
+    auto range = mIntervalRanges.find(index);
+    if (range == mIntervalRanges.end()) {
+      return {};
+    }
+    return std::span<const WindowDescriptor>(mWindows.data() + range->second.first, range->second.second - range->second.first);
+  }
+
+  // indexes of the rate intervals containing at least one window, in increasing order
+  std::vector<int> getRateIntervals() const
+  {
+    std::vector<int> indexes;
+    for (auto& [index, range] : mIntervalRanges) {
+      if (index >= 0) {
+        indexes.push_back(index);
+      }
+    }
+    return indexes;
+  }
+
+ private:
+  std::vector<WindowDescriptor> mWindows;
+  // position of each window before sorting, used to merge the MOs of the same window
+  std::map<std::tuple<int, uint64_t, uint64_t>, size_t> mWindowIndexes;
+  // [first, last) positions of the windows of each rate interval
+  std::map<int, std::pair<size_t, size_t>> mIntervalRanges;
+};
+
+#endif // AQC_WINDOWTABLE_H_
@@ -30,3 +30,8 @@ echo "root -b -q \"aqc_process.C(\\\"${RUNS_CONFIG}\\\", \\\"${PLOTS_CONFIG}\\\"
 root -b -q "aqc_process.C(\"${RUNS_CONFIG}\", \"${PLOTS_CONFIG}\")" #>& "outputs/${ID}/log.txt"
 
 cat "outputs/${ID}/log.txt" | grep "Bad time interval"
+
+REPORT="outputs/${ID}/${YEAR}/${PERIOD}/${PASS}/report.json"
+if [ -e "${REPORT}" ]; then
+    jq -r '.runs[] | "\(.run): \(.status)"' "${REPORT}"
+fi
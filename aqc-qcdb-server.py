@@ -0,0 +1,118 @@
+#! /usr/bin/env python3
+
+# Local server of recorded QCDB objects, implementing the part of the CCDB REST interface used by the QCDB
+# inputs of aqc_process.C: the listing of all the versions of an object, and the retrieval of the version
+# valid at a given time stamp.
+#
+# Usage: aqc-qcdb-server.py RECORDS_DIR [PORT]
+#
+# The versions of an object are stored as RECORDS_DIR/PATH/RUN/VALIDFROM-VALIDUNTIL-CREATED.root, each file
+# containing the object under the "ccdb_object" key, as the files downloaded from the CCDB. The versions are
+# selected by run with the RunNumber metadata, the other metadata being ignored.
+
+import json
+import os
+import sys
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import unquote
+
+RECORDS_DIR = sys.argv[1] if len(sys.argv) > 1 else "records"
+PORT = int(sys.argv[2]) if len(sys.argv) > 2 else 8089
+
+
+def parse_url(url):
+    # object path, time stamp and metadata of a request, the time stamp being the first number after the path
+    path = []
+    timestamp = None
+    metadata = {}
+    for segment in url.split("?")[0].split("/"):
+        segment = unquote(segment)
+        if not segment or segment == "*":
+            continue
+        if "=" in segment:
+            key, value = segment.split("=", 1)
+            metadata[key] = value
+        elif segment.isdigit() and path and timestamp is None:
+            timestamp = int(segment)
+        elif timestamp is None:
+            path.append(segment)
+    return "/".join(path), timestamp, metadata
+
+
+def get_versions(path, metadata):
+    # recorded versions of an object, the latest created first
+    versions = []
+    object_dir = os.path.join(RECORDS_DIR, path)
+    if not os.path.isdir(object_dir):
+        return versions
+    for run in sorted(os.listdir(object_dir)):
+        if not run.isdigit() or ("RunNumber" in metadata and metadata["RunNumber"] != run):
+            continue
+        for file_name in os.listdir(os.path.join(object_dir, run)):
+            fields = file_name[:-len(".root")].split("-") if file_name.endswith(".root") else []
+            if len(fields) != 3 or not all(field.isdigit() for field in fields):
+                continue
+            valid_from, valid_until, created = (int(field) for field in fields)
+            versions.append({
+                "path": path,
+                "id": "-".join([run] + fields),
+                "validFrom": valid_from,
+                "validUntil": valid_until,
+                "Created": created,
+                "createTime": created,
+                "lastModified": created,
+                "RunNumber": run,
+                "fileName": os.path.join(object_dir, run, file_name),
+            })
+    versions.sort(key=lambda version: version["Created"], reverse=True)
+    return versions
+
+
+class RecordsHandler(BaseHTTPRequestHandler):
+    def send_body(self, code, body, content_type, headers={}):
+        self.send_response(code)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(body)))
+        for key, value in headers.items():
+            self.send_header(key, value)
+        self.end_headers()
+        if self.command != "HEAD":
+            self.wfile.write(body)
+
+    def do_GET(self):
+        for listing in ("/browse/", "/latest/"):
+            if self.path.startswith(listing):
+                path, _, metadata = parse_url(self.path[len(listing):])
+                versions = get_versions(path, metadata)
+                if listing == "/latest/":
+                    versions = versions[:1]
+                objects = [{key: value for key, value in version.items() if key != "fileName"} for version in versions]
+                body = json.dumps({"objects": objects, "subfolders": []}).encode()
+                self.send_body(200, body, "application/json")
+                return
+
+        path, timestamp, metadata = parse_url(self.path)
+        versions = [version for version in get_versions(path, metadata)
+                    if timestamp is not None and version["validFrom"] <= timestamp < version["validUntil"]]
+        if not versions:
+            self.send_body(404, b"", "text/plain")
+            return
+        version = versions[0]
+        with open(version["fileName"], "rb") as record:
+            body = record.read()
+        headers = {
+            "Valid-From": str(version["validFrom"]),
+            "Valid-Until": str(version["validUntil"]),
+            "Created": str(version["Created"]),
+            "ETag": "\"" + version["id"] + "\"",
+            "Content-Location": "/" + path + "/" + version["id"],
+            "Content-Disposition": "inline;filename=\"" + os.path.basename(version["fileName"]) + "\"",
+        }
+        self.send_body(200, body, "application/octet-stream", headers)
+
+    do_HEAD = do_GET
+
+
+if __name__ == "__main__":
+    print(f"Serving the recorded objects of {RECORDS_DIR} on port {PORT}", flush=True)
+    ThreadingHTTPServer(("localhost", PORT), RecordsHandler).serve_forever()
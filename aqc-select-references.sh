@@ -0,0 +1,37 @@
+#! /bin/bash
+
+export INFOLOGGER_MODE=stdout
+export SCRIPTDIR=$(readlink -f $(dirname $0))
+#echo "SCRIPTDIR: ${SCRIPTDIR}"
+
+# Propose the reference runs of a production from the results of its processing without reference runs,
+# and write them in the "referenceRuns" block of the runs configuration.
+#
+# Usage: aqc-select-references.sh [-p] RUNS_CONFIG PLOTS_CONFIG
+#
+# With -p the production is first processed without its current reference runs, otherwise the results
+# of the last processing are used.
+
+PROCESS=0
+if [ x"$1" = "x-p" ]; then
+    PROCESS=1
+    shift
+fi
+
+RUNS_CONFIG="$1"
+PLOTS_CONFIG="$2"
+
+if [ x"${PROCESS}" = "x1" ]; then
+    if [[ -z $(which jq) ]]; then
+        echo "The jq command is missing, exiting."
+        exit 1
+    fi
+    # the time windows are compared with the consensus of their rate interval
+    NOREF_CONFIG=$(mktemp --suffix=.json)
+    jq 'del(.referenceRuns)' "${RUNS_CONFIG}" > "${NOREF_CONFIG}"
+    ./aqc-process.sh -s "${NOREF_CONFIG}" "${PLOTS_CONFIG}"
+    rm -f "${NOREF_CONFIG}"
+fi
+
+echo "root -b -q \"aqc_select_references.C(\\\"${RUNS_CONFIG}\\\", \\\"${PLOTS_CONFIG}\\\")\""
+root -b -q "aqc_select_references.C(\"${RUNS_CONFIG}\", \"${PLOTS_CONFIG}\")"
@@ -0,0 +1,62 @@
+#! /bin/bash
+
+export INFOLOGGER_MODE=stdout
+export SCRIPTDIR=$(readlink -f $(dirname $0))
+#echo "SCRIPTDIR: ${SCRIPTDIR}"
+
+# Process a production in NSHARDS independent shards, each extracting the plots of a subset of the runs,
+# followed by the merge step that runs the checks and produces the outputs.
+# The shards are run as local processes, at most NJOBS at a time (default: one per available core).
+#
+# Usage: aqc-shard.sh [-j NJOBS] RUNS_CONFIG PLOTS_CONFIG NSHARDS
+#
+# On a batch farm, each job can instead run one shard with
+#   root -b -q "aqc_process.C(\"RUNS_CONFIG\", \"PLOTS_CONFIG\", \"\", \"I/NSHARDS\")"
+# and the merge step is run once all the shards are completed, with
+#   root -b -q "aqc_process.C(\"RUNS_CONFIG\", \"PLOTS_CONFIG\", \"\", \"merge\")"
+
+if [[ -z $(which jq) ]]; then
+       echo "The jq command is missing, exiting."
+       exit 1
+fi
+
+NJOBS=$(nproc)
+if [ x"$1" = "x-j" ]; then
+    NJOBS="$2"
+    shift 2
+fi
+
+RUNS_CONFIG="$1"
+PLOTS_CONFIG="$2"
+NSHARDS="$3"
+
+YEAR=$(jq ".year" "${RUNS_CONFIG}" | tr -d "\"")
+PERIOD=$(jq ".period" "${RUNS_CONFIG}" | tr -d "\"")
+PASS=$(jq ".pass" "${RUNS_CONFIG}" | tr -d "\"")
+
+ID=$(jq ".id" "${PLOTS_CONFIG}" | tr -d "\"")
+
+OUTPUTDIR="outputs/${ID}/${YEAR}/${PERIOD}/${PASS}"
+SHARDDIR="${OUTPUTDIR}/shards"
+
+# the files of previous shardings must not be merged with the new ones
+rm -rf "${SHARDDIR}"
+mkdir -p "${SHARDDIR}"
+
+echo "Processing ${NSHARDS} shards with ${NJOBS} parallel jobs"
+seq 0 $((NSHARDS - 1)) | xargs -P "${NJOBS}" -I{} \
+    sh -c "root -b -q 'aqc_process.C(\"${RUNS_CONFIG}\", \"${PLOTS_CONFIG}\", \"\", \"{}/${NSHARDS}\")' > '${SHARDDIR}/log-{}.txt' 2>&1 || echo 'Shard {} failed, see ${SHARDDIR}/log-{}.txt'"
+
+NFILES=$(ls "${SHARDDIR}"/shard-*.root 2> /dev/null | wc -l)
+if [ x"${NFILES}" != x"${NSHARDS}" ]; then
+    echo "Only ${NFILES} of ${NSHARDS} shards were completed, exiting."
+    exit 1
+fi
+
+echo "root -b -q \"aqc_process.C(\\\"${RUNS_CONFIG}\\\", \\\"${PLOTS_CONFIG}\\\", \\\"\\\", \\\"merge\\\")\""
+root -b -q "aqc_process.C(\"${RUNS_CONFIG}\", \"${PLOTS_CONFIG}\", \"\", \"merge\")"
+
+REPORT="${OUTPUTDIR}/report.json"
+if [ -e "${REPORT}" ]; then
+    jq -r '.runs[] | "\(.run): \(.status)"' "${REPORT}"
+fi
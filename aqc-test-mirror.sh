@@ -0,0 +1,27 @@
+#! /bin/bash
+
+export INFOLOGGER_MODE=stdout
+export SCRIPTDIR=$(readlink -f $(dirname $0))
+#echo "SCRIPTDIR: ${SCRIPTDIR}"
+
+# Test the local mirrors of the remote input files on a sample QC file, in a temporary folder.
+#
+# Usage: aqc-test-mirror.sh [URL_PREFIX]
+#
+# The sample file is read with a file:// URL by default. Another prefix can be given to read it through a
+# local server exporting the root of the file system, for example "root://localhost/" for XRootD.
+
+URL_PREFIX="${1:-file://}"
+
+TESTDIR=$(mktemp -d)
+cd "${TESTDIR}"
+
+root -b -q "${SCRIPTDIR}/aqc_test_mirror.C(\"${URL_PREFIX}\")" 2>&1 | tee log.txt
+
+if grep -q "^FAILED" log.txt || ! grep -q "All the mirror tests passed" log.txt; then
+    echo "Mirror tests failed, see ${TESTDIR}"
+    exit 1
+fi
+
+cd - > /dev/null
+rm -rf "${TESTDIR}"
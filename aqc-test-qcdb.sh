@@ -0,0 +1,35 @@
+#! /bin/bash
+
+export INFOLOGGER_MODE=stdout
+export SCRIPTDIR=$(readlink -f $(dirname $0))
+#echo "SCRIPTDIR: ${SCRIPTDIR}"
+
+# Test the QCDB inputs on recorded objects served locally by aqc-qcdb-server.py, in a temporary folder.
+#
+# Usage: aqc-test-qcdb.sh [PORT]
+
+PORT="${1:-8089}"
+
+TESTDIR=$(mktemp -d)
+cd "${TESTDIR}"
+mkdir -p records
+
+python3 "${SCRIPTDIR}/aqc-qcdb-server.py" records "${PORT}" >& server-log.txt &
+SERVER_PID=$!
+trap "kill ${SERVER_PID} 2> /dev/null" EXIT
+
+# wait until the server accepts connections
+for I in $(seq 1 50); do
+    (echo > "/dev/tcp/localhost/${PORT}") 2> /dev/null && break
+    sleep 0.1
+done
+
+root -b -q "${SCRIPTDIR}/aqc_test_qcdb.C(\"http://localhost:${PORT}\")" 2>&1 | tee log.txt
+
+if grep -q "^FAILED" log.txt || ! grep -q "All the QCDB tests passed" log.txt; then
+    echo "QCDB tests failed, see ${TESTDIR}"
+    exit 1
+fi
+
+cd - > /dev/null
+rm -rf "${TESTDIR}"
@@ -0,0 +1,92 @@
+#! /bin/bash
+
+export INFOLOGGER_MODE=stdout
+export SCRIPTDIR=$(readlink -f $(dirname $0))
+#echo "SCRIPTDIR: ${SCRIPTDIR}"
+
+# Watch the input folder of a production, and process the runs as soon as their QC files are
+# created or updated. The runs updated within QUIET_TIME seconds of each other are processed together,
+# and only the rate intervals containing their time windows are checked again.
+#
+# Usage: aqc-watch.sh [-q QUIET_TIME] RUNS_CONFIG PLOTS_CONFIG
+
+if [[ -z $(which jq) ]]; then
+       echo "The jq command is missing, exiting."
+       exit 1
+fi
+
+if [[ -z $(which inotifywait) ]]; then
+       echo "The inotifywait command (inotify-tools) is missing, exiting."
+       exit 1
+fi
+
+QUIET_TIME=60
+if [ x"$1" = "x-q" ]; then
+    QUIET_TIME="$2"
+    shift 2
+fi
+
+RUNS_CONFIG="$1"
+PLOTS_CONFIG="$2"
+
+YEAR=$(jq ".year" "${RUNS_CONFIG}" | tr -d "\"")
+PERIOD=$(jq ".period" "${RUNS_CONFIG}" | tr -d "\"")
+PASS=$(jq ".pass" "${RUNS_CONFIG}" | tr -d "\"")
+
+ID=$(jq ".id" "${PLOTS_CONFIG}" | tr -d "\"")
+
+INPUTDIR="inputs/${YEAR}/${PERIOD}/${PASS}"
+OUTPUTDIR="outputs/${ID}/${YEAR}/${PERIOD}/${PASS}"
+REPORT="${OUTPUTDIR}/report.json"
+
+mkdir -p "${INPUTDIR}" "${OUTPUTDIR}"
+
+process_runs() {
+    local RUNLIST="$1"
+    echo "$(date '+%F %T') processing updated runs: ${RUNLIST}"
+    root -b -q "aqc_process.C(\"${RUNS_CONFIG}\", \"${PLOTS_CONFIG}\", \"${RUNLIST}\")" >& "${OUTPUTDIR}/watch-log.txt"
+
+    if [ -e "${REPORT}" ]; then
+        for RUN in $(echo "${RUNLIST}" | tr "," " "); do
+            jq -r --argjson run "${RUN}" '.runs[] | select(.run == $run) | "\(.run): \(.status)"' "${REPORT}"
+        done
+    fi
+}
+
+# the full processing provides the results that are then updated incrementally
+if [ ! -e "${REPORT}" ]; then
+    echo "$(date '+%F %T') no previous report found, processing all runs"
+    root -b -q "aqc_process.C(\"${RUNS_CONFIG}\", \"${PLOTS_CONFIG}\")" >& "${OUTPUTDIR}/watch-log.txt"
+fi
+
+echo "Watching ${INPUTDIR} for new QC files"
+
+declare -A UPDATED_RUNS
+while true; do
+    # the file events are collected until no new event is received for QUIET_TIME seconds
+    read -r -t "${QUIET_TIME}" FILE
+    RC=$?
+    if [ ${RC} -eq 0 ]; then
+        case "${FILE}" in
+            *.root)
+                RUN=$(basename $(dirname "${FILE}"))
+                if [[ "${RUN}" =~ ^[0-9]+$ ]]; then
+                    echo "$(date '+%F %T') updated file ${FILE}"
+                    UPDATED_RUNS[${RUN}]=1
+                fi
+                ;;
+        esac
+        continue
+    fi
+
+    # a status above 128 is a timeout, any other status means that inotifywait has terminated
+    if [ ${RC} -le 128 ]; then
+        break
+    fi
+
+    if [ ${#UPDATED_RUNS[@]} -gt 0 ]; then
+        RUNLIST=$(echo "${!UPDATED_RUNS[@]}" | tr " " "\n" | sort -n | tr "\n" "," | sed 's/,$//')
+        UPDATED_RUNS=()
+        process_runs "${RUNLIST}"
+    fi
+done < <(inotifywait -m -r -q -e close_write -e moved_to --format '%w%f' "${INPUTDIR}")